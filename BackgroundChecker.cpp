@@ -0,0 +1,118 @@
+#include "BackgroundChecker.h"
+#include "Logging.h"
+
+BackgroundChecker::BackgroundChecker(std::chrono::milliseconds debounce_interval)
+    : m_debounce_interval(debounce_interval),
+      m_generation(0),
+      m_checked_generation(0),
+      m_busy(false),
+      m_stop(false)
+{
+}
+
+BackgroundChecker::~BackgroundChecker()
+{
+    Stop();
+}
+
+void BackgroundChecker::Start(CreateREPLFn create_repl, GetTextFn get_text, DiagnosticsFn on_diagnostics)
+{
+    m_create_repl = std::move(create_repl);
+    m_get_text = std::move(get_text);
+    m_on_diagnostics = std::move(on_diagnostics);
+    m_stop = false;
+    m_worker = std::thread(&BackgroundChecker::WorkerLoop, this);
+}
+
+void BackgroundChecker::Stop()
+{
+    if(!m_worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    m_worker.join();
+    m_repl.reset();
+}
+
+void BackgroundChecker::NotifyEdit()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_generation++;
+    }
+    m_wakeup.notify_all();
+}
+
+void BackgroundChecker::WaitForIdle()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    if(!m_worker.joinable())
+        return;
+    m_idle.wait(lock, [&]() { return m_stop || (!m_busy && m_checked_generation == m_generation); });
+}
+
+std::unique_ptr<REPL> BackgroundChecker::TakeREPL()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    if(!m_worker.joinable())
+        return nullptr;
+    // Cancels the check in progress, which also makes the worker warm up a new REPL
+    m_generation++;
+    m_wakeup.notify_all();
+    m_idle.wait(lock, [&]() { return !m_busy; });
+    std::unique_ptr<REPL> repl = std::move(m_repl);
+    if(repl)
+        repl->SetDiagnosticHandler(nullptr);
+    return repl;
+}
+
+void BackgroundChecker::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    while(true)
+    {
+        m_wakeup.wait(lock, [&]() { return m_stop || m_checked_generation != m_generation; });
+        if(m_stop)
+            break;
+
+        // Debounce: start over whenever another edit arrives during the interval
+        uint64_t generation = m_generation;
+        if(m_wakeup.wait_for(lock, m_debounce_interval,
+                             [&]() { return m_stop || m_generation != generation; }))
+            continue;
+
+        m_busy = true;
+        std::unique_ptr<REPL> repl = std::move(m_repl);
+        lock.unlock();
+
+        if(!repl)
+            repl = m_create_repl();
+        std::vector<REPL::Diagnostic> diagnostics;
+        bool cancelled = false;
+        if(repl)
+        {
+            repl->SetDiagnosticHandler([&](const REPL::Diagnostic &diagnostic) { diagnostics.push_back(diagnostic); });
+            std::string text = m_get_text();
+            repl->CheckSwift(text, [&]() { return m_generation != generation || m_stop; });
+            repl->SetDiagnosticHandler(nullptr);
+            cancelled = m_generation != generation;
+        }
+        if(!cancelled && m_on_diagnostics)
+            m_on_diagnostics(diagnostics);
+
+        SetCurrentLoggingArea(LoggingArea::AST);
+        Log(std::string(cancelled ? "Cancelled" : "Finished") + " background check of generation " + std::to_string(generation));
+
+        lock.lock();
+        m_repl = std::move(repl);
+        m_busy = false;
+        if(!cancelled)
+            m_checked_generation = generation;
+        m_idle.notify_all();
+    }
+    m_busy = false;
+    m_idle.notify_all();
+}
@@ -0,0 +1,69 @@
+#ifndef BACKGROUND_CHECKER_H
+#define BACKGROUND_CHECKER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "REPL.h"
+
+// Type-checks the playground's document on a worker thread while the user types.
+//
+// Every edit bumps a generation counter. The worker waits until no edit has arrived
+// for the debounce interval, then checks the text of the latest generation. If another
+// edit arrives while it's checking, the check is abandoned at the next stage boundary
+// and its diagnostics are never published, so only results for the text currently on
+// screen show up.
+//
+// The worker's REPL has already loaded the standard library and the document's imports
+// by the time the user runs the playground, so TakeREPL hands it over to be executed
+// in instead of starting a cold one, and the worker warms up a new one.
+class BackgroundChecker
+{
+public:
+    using CreateREPLFn = std::function<std::unique_ptr<REPL>()>;
+    using GetTextFn = std::function<std::string()>;
+    // Called on the worker thread
+    using DiagnosticsFn = std::function<void(const std::vector<REPL::Diagnostic> &)>;
+
+    BackgroundChecker(std::chrono::milliseconds debounce_interval = std::chrono::milliseconds(250));
+    ~BackgroundChecker();
+
+    void Start(CreateREPLFn create_repl, GetTextFn get_text, DiagnosticsFn on_diagnostics);
+    void Stop();
+
+    // Called after every edit. Cancels a check that is in progress.
+    void NotifyEdit();
+    // Blocks until the current generation has been checked
+    void WaitForIdle();
+    // Returns the worker's REPL or nullptr if it doesn't have one yet. Waits for a
+    // check in progress to finish or be cancelled.
+    std::unique_ptr<REPL> TakeREPL();
+
+private:
+    void WorkerLoop();
+
+    const std::chrono::milliseconds m_debounce_interval;
+    CreateREPLFn m_create_repl;
+    GetTextFn m_get_text;
+    DiagnosticsFn m_on_diagnostics;
+
+    std::mutex m_lock;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_idle;
+    std::atomic<uint64_t> m_generation;
+    uint64_t m_checked_generation;
+    bool m_busy;
+    std::atomic<bool> m_stop;
+    std::unique_ptr<REPL> m_repl;
+    std::thread m_worker;
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "swift_repl.h"
+#include "OutputCapture.h"
+#include "REPL.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+struct swift_repl_session
+{
+    std::unique_ptr<REPL> repl;
+    swift_repl_output_fn output_fn = nullptr;
+    void *output_context = nullptr;
+    swift_repl_diagnostic_fn diagnostic_fn = nullptr;
+    void *diagnostic_context = nullptr;
+};
+
+// stdout belongs to the process, so a single capture serves every session. It runs
+// while any session has an output sink.
+static std::mutex g_capture_lock;
+static std::unique_ptr<OutputCapture> g_capture;
+static int g_sessions_with_sinks = 0;
+
+// Held for the duration of an evaluation, so that what is captured meanwhile belongs
+// to the evaluating session
+static std::mutex g_eval_lock;
+static std::atomic<swift_repl_session *> g_evaluating_session{ nullptr };
+
+static void DeliverOutput(const char *data, size_t size)
+{
+    swift_repl_session *session = g_evaluating_session;
+    if(session && session->output_fn)
+    {
+        session->output_fn(session->output_context, data, size);
+        return;
+    }
+
+    // Output nobody asked for, e.g. from a thread the evaluated code left running
+    int fd = g_capture->GetOriginalStdout();
+    while(size > 0)
+    {
+        auto written = write(fd, data, static_cast<unsigned>(size));
+        if(written <= 0)
+            return;
+        data += written;
+        size -= written;
+    }
+}
+
+static swift_repl_diagnostic_kind DiagnosticKind(swift::DiagnosticKind kind)
+{
+    switch(kind)
+    {
+    case swift::DiagnosticKind::Error:
+        return SWIFT_REPL_DIAGNOSTIC_ERROR;
+    case swift::DiagnosticKind::Warning:
+        return SWIFT_REPL_DIAGNOSTIC_WARNING;
+    case swift::DiagnosticKind::Remark:
+        return SWIFT_REPL_DIAGNOSTIC_REMARK;
+    case swift::DiagnosticKind::Note:
+        return SWIFT_REPL_DIAGNOSTIC_NOTE;
+    }
+    return SWIFT_REPL_DIAGNOSTIC_ERROR;
+}
+
+swift_repl_session *swift_repl_create(const char *module_cache_path)
+{
+    llvm::Expected<std::unique_ptr<REPL>> repl = module_cache_path ?
+        REPL::Create(false, module_cache_path) : REPL::Create(false);
+    if(!repl)
+    {
+        llvm::consumeError(repl.takeError());
+        return nullptr;
+    }
+
+    swift_repl_session *session = new swift_repl_session;
+    session->repl = std::move(*repl);
+    return session;
+}
+
+void swift_repl_destroy(swift_repl_session *session)
+{
+    if(!session)
+        return;
+    swift_repl_set_output_sink(session, nullptr, nullptr);
+    delete session;
+}
+
+void swift_repl_set_optimizations_enabled(swift_repl_session *session, int enabled)
+{
+    session->repl->SetOptimizationsEnabled(enabled != 0);
+}
+
+void swift_repl_add_module_search_path(swift_repl_session *session, const char *path)
+{
+    session->repl->AddModuleSearchPath(path);
+}
+
+void swift_repl_add_library_search_path(swift_repl_session *session, const char *path)
+{
+    session->repl->AddLoadSearchPath(path);
+}
+
+int swift_repl_set_output_sink(swift_repl_session *session, swift_repl_output_fn fn, void *context)
+{
+    std::lock_guard<std::mutex> eval_guard(g_eval_lock);
+    std::lock_guard<std::mutex> capture_guard(g_capture_lock);
+    bool had_sink = session->output_fn != nullptr;
+    if(fn && !had_sink)
+    {
+        if(!g_capture)
+        {
+            g_capture.reset(new OutputCapture());
+            if(!g_capture->Start(DeliverOutput))
+            {
+                g_capture.reset();
+                return 0;
+            }
+        }
+        g_sessions_with_sinks++;
+    }
+    else if(!fn && had_sink && --g_sessions_with_sinks == 0)
+    {
+        g_capture->Stop();
+        g_capture.reset();
+    }
+    session->output_fn = fn;
+    session->output_context = context;
+    return 1;
+}
+
+void swift_repl_set_diagnostic_sink(swift_repl_session *session, swift_repl_diagnostic_fn fn, void *context)
+{
+    session->diagnostic_fn = fn;
+    session->diagnostic_context = context;
+    if(!fn)
+    {
+        session->repl->SetDiagnosticHandler(nullptr);
+        return;
+    }
+    session->repl->SetDiagnosticHandler([session](const REPL::Diagnostic &diagnostic)
+                                        {
+                                            session->diagnostic_fn(session->diagnostic_context,
+                                                                   DiagnosticKind(diagnostic.kind),
+                                                                   diagnostic.line, diagnostic.column,
+                                                                   diagnostic.message.data(),
+                                                                   diagnostic.message.size());
+                                        });
+}
+
+swift_repl_status swift_repl_eval(swift_repl_session *session, const char *source, size_t length)
+{
+    std::lock_guard<std::mutex> guard(g_eval_lock);
+    g_evaluating_session = session;
+    bool keep_going = session->repl->ExecuteSwift(llvm::StringRef(source, length));
+    {
+        std::lock_guard<std::mutex> capture_guard(g_capture_lock);
+        if(g_capture)
+            g_capture->Flush();
+        else
+            fflush(stdout);
+    }
+    g_evaluating_session = nullptr;
+
+    if(!keep_going)
+        return SWIFT_REPL_EXITED;
+    return session->repl->LastInputHadError() ? SWIFT_REPL_ERROR : SWIFT_REPL_OK;
+}
+
+static swift_repl_result_kind ResultKindCode(ResultKind kind)
+{
+    switch(kind)
+    {
+    case ResultKind::None:
+        return SWIFT_REPL_RESULT_NONE;
+    case ResultKind::Int:
+        return SWIFT_REPL_RESULT_INT;
+    case ResultKind::UInt:
+        return SWIFT_REPL_RESULT_UINT;
+    case ResultKind::Float:
+        return SWIFT_REPL_RESULT_FLOAT;
+    case ResultKind::Double:
+        return SWIFT_REPL_RESULT_DOUBLE;
+    case ResultKind::Bool:
+        return SWIFT_REPL_RESULT_BOOL;
+    case ResultKind::String:
+        return SWIFT_REPL_RESULT_STRING;
+    case ResultKind::Array:
+        return SWIFT_REPL_RESULT_ARRAY;
+    case ResultKind::Unsupported:
+        return SWIFT_REPL_RESULT_UNSUPPORTED;
+    }
+    return SWIFT_REPL_RESULT_UNSUPPORTED;
+}
+
+static ResultKind ResultKindFromCode(swift_repl_result_kind kind)
+{
+    switch(kind)
+    {
+    case SWIFT_REPL_RESULT_NONE:
+        return ResultKind::None;
+    case SWIFT_REPL_RESULT_INT:
+        return ResultKind::Int;
+    case SWIFT_REPL_RESULT_UINT:
+        return ResultKind::UInt;
+    case SWIFT_REPL_RESULT_FLOAT:
+        return ResultKind::Float;
+    case SWIFT_REPL_RESULT_DOUBLE:
+        return ResultKind::Double;
+    case SWIFT_REPL_RESULT_BOOL:
+        return ResultKind::Bool;
+    case SWIFT_REPL_RESULT_STRING:
+        return ResultKind::String;
+    case SWIFT_REPL_RESULT_ARRAY:
+        return ResultKind::Array;
+    case SWIFT_REPL_RESULT_UNSUPPORTED:
+        return ResultKind::Unsupported;
+    }
+    return ResultKind::Unsupported;
+}
+
+static void ToCResult(const ResultValue &value, swift_repl_result *result)
+{
+    result->kind = ResultKindCode(value.kind);
+    result->bit_width = value.bit_width;
+    result->int_value = value.int_value;
+    result->uint_value = value.uint_value;
+    result->float_value = value.float_value;
+    result->bool_value = value.bool_value ? 1 : 0;
+    result->data = value.data;
+    result->count = value.count;
+    result->element_kind = ResultKindCode(value.element_kind);
+    result->element_bit_width = value.element_bit_width;
+    result->element_stride = value.element_stride;
+}
+
+void swift_repl_set_print_results(swift_repl_session *session, int print)
+{
+    session->repl->SetPrintResults(print != 0);
+}
+
+void swift_repl_get_result(swift_repl_session *session, swift_repl_result *result)
+{
+    std::lock_guard<std::mutex> guard(g_eval_lock);
+    ToCResult(session->repl->GetLastResult(), result);
+}
+
+void swift_repl_get_element(const swift_repl_result *array, size_t index, swift_repl_result *element)
+{
+    // Only what GetElement reads of an Array
+    ResultValue value;
+    value.kind = ResultKindFromCode(array->kind);
+    value.data = array->data;
+    value.count = array->count;
+    value.element_kind = ResultKindFromCode(array->element_kind);
+    value.element_bit_width = array->element_bit_width;
+    value.element_stride = array->element_stride;
+    ToCResult(value.GetElement(index), element);
+}
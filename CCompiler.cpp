@@ -0,0 +1,234 @@
+#include "CCompiler.h"
+#include "Config.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <clang/AST/ASTConsumer.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/CodeGen/CodeGenAction.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/MultiplexConsumer.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Lex/Lexer.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
+
+#include <swift/AST/DiagnosticsClangImporter.h>
+
+namespace
+{
+
+// Clang's diagnostics have no location in the SourceManager, so the location goes
+// in front of the message, like Clang prints it
+class ForwardingDiagnosticConsumer : public clang::DiagnosticConsumer
+{
+public:
+    explicit ForwardingDiagnosticConsumer(swift::DiagnosticEngine &diagnostic_engine)
+        : m_diagnostic_engine(diagnostic_engine) {}
+
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level level, const clang::Diagnostic &info) override
+    {
+        clang::DiagnosticConsumer::HandleDiagnostic(level, info);
+
+        llvm::SmallString<128> message;
+        if(info.getLocation().isValid() && info.hasSourceManager())
+        {
+            clang::PresumedLoc loc = info.getSourceManager().getPresumedLoc(info.getLocation());
+            if(loc.isValid())
+            {
+                llvm::raw_svector_ostream stream(message);
+                stream << llvm::sys::path::filename(loc.getFilename()) << ":" << loc.getLine() << ":"
+                       << loc.getColumn() << ": ";
+            }
+        }
+        info.FormatDiagnostic(message);
+
+        switch(level)
+        {
+        case clang::DiagnosticsEngine::Error:
+        case clang::DiagnosticsEngine::Fatal:
+            m_diagnostic_engine.diagnose(swift::SourceLoc(), swift::diag::error_from_clang, message);
+            break;
+        case clang::DiagnosticsEngine::Warning:
+            m_diagnostic_engine.diagnose(swift::SourceLoc(), swift::diag::warning_from_clang, message);
+            break;
+        case clang::DiagnosticsEngine::Note:
+            m_diagnostic_engine.diagnose(swift::SourceLoc(), swift::diag::note_from_clang, message);
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    swift::DiagnosticEngine &m_diagnostic_engine;
+};
+
+// Builds the header from the file's top-level declarations as text edits, so that
+// macros, includes and comments stay as they were written
+class HeaderWriter : public clang::ASTConsumer
+{
+public:
+    explicit HeaderWriter(std::string &header) : m_header(header) {}
+
+    void HandleTranslationUnit(clang::ASTContext &ast_ctx) override
+    {
+        clang::SourceManager &src_mgr = ast_ctx.getSourceManager();
+        const clang::LangOptions &lang_opts = ast_ctx.getLangOpts();
+        llvm::StringRef text = src_mgr.getBufferData(src_mgr.getMainFileID());
+
+        auto offset = [&](clang::SourceLocation loc) { return src_mgr.getFileOffset(loc); };
+        auto end_offset = [&](clang::SourceLocation loc)
+                          {
+                              return offset(clang::Lexer::getLocForEndOfToken(loc, 0, src_mgr, lang_opts));
+                          };
+
+        for(clang::Decl *decl : ast_ctx.getTranslationUnitDecl()->decls())
+        {
+            clang::SourceRange range = decl->getSourceRange();
+            if(range.getBegin().isMacroID() || range.getEnd().isMacroID() ||
+               !src_mgr.isInMainFile(range.getBegin()))
+                continue;
+
+            if(auto *fn = llvm::dyn_cast<clang::FunctionDecl>(decl))
+            {
+                if(!fn->doesThisDeclarationHaveABody())
+                    continue;
+                if(!fn->isExternallyVisible() || fn->isInlineSpecified())
+                    AddEdit(offset(range.getBegin()), end_offset(range.getEnd()), "");
+                else
+                    AddEdit(offset(fn->getBody()->getBeginLoc()), end_offset(fn->getBody()->getEndLoc()), ";");
+            }
+            else if(auto *var = llvm::dyn_cast<clang::VarDecl>(decl))
+            {
+                if(var->isThisDeclarationADefinition() == clang::VarDecl::DeclarationOnly)
+                    continue;
+                if(!var->isExternallyVisible())
+                {
+                    AddEdit(offset(range.getBegin()), end_offset(range.getEnd()), "");
+                    continue;
+                }
+                if(var->getStorageClass() != clang::SC_Extern)
+                    AddEdit(offset(range.getBegin()), offset(range.getBegin()), "extern ");
+                if(const clang::Expr *init = var->getInit())
+                {
+                    // The '=' before the initializer goes too, as do macros it's written with
+                    size_t begin = text.rfind('=', offset(src_mgr.getExpansionLoc(init->getBeginLoc())));
+                    clang::SourceLocation end = src_mgr.getExpansionRange(init->getEndLoc()).getEnd();
+                    if(begin != llvm::StringRef::npos)
+                        AddEdit(begin, end_offset(end), "");
+                }
+            }
+        }
+
+        // Declarations sharing a specifier, like int a = 1, b = 2, produce overlapping
+        // and repeated edits
+        std::stable_sort(m_edits.begin(), m_edits.end(),
+                         [](const Edit &a, const Edit &b) { return a.begin < b.begin; });
+        m_header.clear();
+        size_t copied_until = 0;
+        const Edit *last = nullptr;
+        for(const Edit &edit : m_edits)
+        {
+            if(edit.begin < copied_until || (last && edit.begin == last->begin && edit.end == last->end))
+            {
+                copied_until = std::max(copied_until, edit.end);
+                continue;
+            }
+            m_header += text.slice(copied_until, edit.begin);
+            m_header += edit.replacement;
+            copied_until = edit.end;
+            last = &edit;
+        }
+        m_header += text.substr(copied_until);
+    }
+
+private:
+    struct Edit
+    {
+        size_t begin;
+        size_t end;
+        const char *replacement;
+    };
+
+    void AddEdit(size_t begin, size_t end, const char *replacement)
+    {
+        m_edits.push_back({ begin, end, replacement });
+    }
+
+    std::string &m_header;
+    std::vector<Edit> m_edits;
+};
+
+class CompileCAction : public clang::EmitLLVMOnlyAction
+{
+public:
+    CompileCAction(llvm::LLVMContext &llvm_ctx, std::string &header)
+        : clang::EmitLLVMOnlyAction(&llvm_ctx), m_header(header) {}
+
+protected:
+    std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &compiler,
+                                                          llvm::StringRef file) override
+    {
+        std::vector<std::unique_ptr<clang::ASTConsumer>> consumers;
+        consumers.push_back(clang::EmitLLVMOnlyAction::CreateASTConsumer(compiler, file));
+        consumers.push_back(std::make_unique<HeaderWriter>(m_header));
+        return std::make_unique<clang::MultiplexConsumer>(std::move(consumers));
+    }
+
+private:
+    std::string &m_header;
+};
+
+}
+
+std::unique_ptr<llvm::Module> CompileC(llvm::StringRef path,
+                                       llvm::LLVMContext &llvm_ctx,
+                                       swift::DiagnosticEngine &diagnostic_engine,
+                                       std::string &header)
+{
+    ForwardingDiagnosticConsumer diagnostics(diagnostic_engine);
+    llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> clang_diagnostics =
+        clang::CompilerInstance::createDiagnostics(new clang::DiagnosticOptions(), &diagnostics,
+                                                   false /* ShouldOwnClient */);
+
+    std::string triple = llvm::sys::getProcessTriple();
+    std::string path_str = path.str();
+    // The driver works out the system include paths
+    const char *args[] =
+    {
+        "clang", "-target", triple.c_str(), "-resource-dir", SWIFT_CLANG_RESOURCE_DIR,
+        "-x", "c", "-std=gnu11", "-O2", path_str.c_str(),
+    };
+    std::shared_ptr<clang::CompilerInvocation> invocation =
+        clang::createInvocationFromCommandLine(args, clang_diagnostics);
+    if(!invocation)
+        return nullptr;
+
+    clang::TargetOptions &target_opts = invocation->getTargetOpts();
+    target_opts.CPU = llvm::sys::getHostCPUName();
+    llvm::StringMap<bool> features;
+    if(llvm::sys::getHostCPUFeatures(features))
+    {
+        for(const auto &feature : features)
+            target_opts.FeaturesAsWritten.push_back((feature.second ? "+" : "-") + feature.first().str());
+    }
+    // The driver asks cc1 to leak everything at exit, which would be every input here
+    invocation->getFrontendOpts().DisableFree = false;
+
+    clang::CompilerInstance compiler;
+    compiler.setInvocation(std::move(invocation));
+    compiler.setDiagnostics(clang_diagnostics.get());
+
+    CompileCAction action(llvm_ctx, header);
+    if(!compiler.ExecuteAction(action) || diagnostics.getNumErrors() != 0)
+        return nullptr;
+    return action.takeModule();
+}
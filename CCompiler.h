@@ -0,0 +1,26 @@
+#ifndef C_COMPILER_H
+#define C_COMPILER_H
+
+#include <memory>
+#include <string>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <swift/AST/DiagnosticEngine.h>
+
+// Compiles a C file with the Clang the REPL links for the ClangImporter, at -O2 for the
+// host CPU. Clang's diagnostics are reported through diagnostic_engine.
+//
+// header is set to what Swift should import to call into the file: the file itself,
+// with function bodies and variable initializers removed and definitions that aren't
+// visible outside of it (static, inline) dropped.
+//
+// Returns nullptr on errors.
+std::unique_ptr<llvm::Module> CompileC(llvm::StringRef path,
+                                       llvm::LLVMContext &llvm_ctx,
+                                       swift::DiagnosticEngine &diagnostic_engine,
+                                       std::string &header);
+
+#endif
@@ -16,6 +16,7 @@ void HandleUnknownOption(std::string opt, std::string val, CommandLineOptions &o
 
 void SetLoggingAreaOption(std::string opt, std::string val, CommandLineOptions &opts)
 {
+    ToLowerCase(val);
     auto area = llvm::StringSwitch<LoggingArea>(val)
         .Case(     "ast", LoggingArea::AST)
         .Case(     "sil", LoggingArea::SIL)
@@ -33,6 +34,7 @@ void SetLoggingAreaOption(std::string opt, std::string val, CommandLineOptions &
 
 void SetLoggingPriorityOption(std::string opt, std::string val, CommandLineOptions &opts)
 {
+    ToLowerCase(val);
     auto priority = llvm::StringSwitch<LoggingPriority>(val)
         .Case("info", LoggingPriority::Info)
         .Case("warning", LoggingPriority::Warning)
@@ -48,6 +50,7 @@ void SetLoggingPriorityOption(std::string opt, std::string val, CommandLineOptio
 
 void SetPlaygroundOption(std::string opt, std::string val, CommandLineOptions &opts)
 {
+    ToLowerCase(val);
     int is_playground = llvm::StringSwitch<int>(val)
         .Case("true", 1)
         .Case("false", 0)
@@ -57,11 +60,62 @@ void SetPlaygroundOption(std::string opt, std::string val, CommandLineOptions &o
     opts.is_playground = is_playground == 1;
 }
 
+void SetOptimizeOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    ToLowerCase(val);
+    int optimize = llvm::StringSwitch<int>(val)
+        .Case("true", 1)
+        .Case("false", 0)
+        .Default(-1);
+    if(optimize == -1)
+        std::cout << "[Warning] optimize is neither \"true\" nor \"false\". Defaulting to \"false\"\n";
+    opts.optimize = optimize == 1;
+}
+
+void SetPlaygroundLoggingOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    ToLowerCase(val);
+    int playground_logging = llvm::StringSwitch<int>(val)
+        .Case("true", 1)
+        .Case("false", 0)
+        .Default(-1);
+    if(playground_logging == -1)
+        std::cout << "[Warning] playground_logging is neither \"true\" nor \"false\". Defaulting to \"false\"\n";
+    opts.playground_logging = playground_logging == 1;
+}
+
+void SetProtocolOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    ToLowerCase(val);
+    int framed = llvm::StringSwitch<int>(val)
+        .Case("framed", 1)
+        .Case("text", 0)
+        .Default(-1);
+    if(framed == -1)
+        std::cout << "[Warning] protocol is neither \"framed\" nor \"text\". Defaulting to \"text\"\n";
+    opts.framed_protocol = framed == 1;
+}
+
 void SetModuleCachePathOption(std::string opt, std::string val, CommandLineOptions &opts)
 {
     opts.default_module_cache_path = val;
 }
 
+void SetRecordOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    opts.record_path = val;
+}
+
+void SetReplayOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    opts.replay_path = val;
+}
+
+void SetScriptOption(std::string opt, std::string val, CommandLineOptions &opts)
+{
+    opts.script_path = val;
+}
+
 void HandleOptionWithoutEquals(std::string arg, CommandLineOptions &opts)
 {
     // NOTE(sasha): The 2 comes from the length of "-i" or "-l"
@@ -69,6 +123,10 @@ void HandleOptionWithoutEquals(std::string arg, CommandLineOptions &opts)
         opts.include_paths.push_back(arg.substr(2));
     else if(StartsWith(arg, "-L"))
         opts.link_paths.push_back(arg.substr(2));
+    else if(arg == "--timing")
+        opts.timing = true;
+    else if(arg == "--check-only")
+        opts.check_only = true;
     else
         std::cout << "[Warning] Ignoring unrecognized parameter \"" << arg << "\"\n";
 }
@@ -80,14 +138,21 @@ void ParseSingleCommandLineOption(std::string arg, CommandLineOptions &opts)
     if(delimeter_pos == std::string::npos)
         return HandleOptionWithoutEquals(arg, opts);
 
-    ToLowerCase(arg);
+    // Only the option name is case insensitive, values may be paths
     std::string opt = arg.substr(0, delimeter_pos);
     std::string val = arg.substr(delimeter_pos + 1, arg.size() - opt.size() - 1);
+    ToLowerCase(opt);
     llvm::StringSwitch<OptionParseFn>(opt)
         .Case("--logging", SetLoggingAreaOption)
         .Case("--logging_priority", SetLoggingPriorityOption)
         .Case("--playground", SetPlaygroundOption)
+        .Case("--optimize", SetOptimizeOption)
+        .Case("--playground_logging", SetPlaygroundLoggingOption)
+        .Case("--protocol", SetProtocolOption)
         .Case("--module_cache_path", SetModuleCachePathOption)
+        .Case("--record", SetRecordOption)
+        .Case("--replay", SetReplayOption)
+        .Case("--script", SetScriptOption)
         .Default(HandleUnknownOption)
         (opt, val, opts);
 }
@@ -107,7 +172,7 @@ void SetupDefaultsIfUninitialized(CommandLineOptions &opts)
 //TODO(sasha): Make this more robust to things like -I <path> (with a space)
 CommandLineOptions ParseCommandLineOptions(int argc, char **argv)
 {
-    CommandLineOptions result;
+    CommandLineOptions result = {};
     for(int i = 1; i < argc; i++)
     {
         std::string sanitized_option = argv[i];
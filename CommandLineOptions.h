@@ -10,9 +10,17 @@ struct CommandLineOptions
 {
     LoggingOptions logging_opts;
     bool is_playground;
+    bool optimize;
+    bool playground_logging;
     std::string default_module_cache_path;
     std::vector<std::string> include_paths;
     std::vector<std::string> link_paths;
+    std::string record_path;
+    std::string replay_path;
+    std::string script_path;
+    bool timing;
+    bool check_only;
+    bool framed_protocol;
 };
 
 CommandLineOptions ParseCommandLineOptions(int argc, char **argv);
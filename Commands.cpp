@@ -0,0 +1,476 @@
+#include "REPL.h"
+#include "Logging.h"
+#include "Strings.h"
+#include "Config.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/BinaryFormat/Magic.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <swift/AST/Decl.h>
+#include <swift/AST/NameLookup.h>
+#include <swift/Parse/Lexer.h>
+
+// Commands return the same thing as ExecuteSwift: false if the REPL should exit.
+bool REPL::ExecuteCommand(llvm::StringRef line)
+{
+    using CommandFn = bool (REPL::*)(llvm::StringRef);
+    // The command ends at the first space or newline, so that a raw block can be
+    // executed in one go, as when it's sent through the C API
+    llvm::StringRef trimmed = line.trim();
+    llvm::StringRef command = trimmed.take_until([](char c) { return c == ' ' || c == '\n'; });
+    llvm::StringRef args = trimmed.drop_front(command.size()).trim();
+
+    // A command isn't an input and keeps its number, but whether it failed is
+    // only about the command itself
+    m_diagnostic_engine.resetHadAnyError();
+    m_input_rejected = false;
+
+    CommandFn fn = llvm::StringSwitch<CommandFn>(command)
+        .Case(":remarks", &REPL::PrintRemarksCommand)
+        .Case(":layout", &REPL::LayoutCommand)
+        .Case(":check", &REPL::CheckCommand)
+        .Case(":load", &REPL::LoadCommand)
+        .Case(":link", &REPL::LinkCommand)
+        .Case(":map", &REPL::MapCommand)
+        .Case(":sil-begin", &REPL::SILBeginCommand)
+        .Case(":sil-end", &REPL::RawBlockEndCommand)
+        .Case(":llvm-begin", &REPL::LLVMBeginCommand)
+        .Case(":llvm-end", &REPL::RawBlockEndCommand)
+        .Case(":c-begin", &REPL::CBeginCommand)
+        .Case(":c-end", &REPL::RawBlockEndCommand)
+        .Case(":export", &REPL::ExportCommand)
+        .Case(":help", &REPL::HelpCommand)
+        .Default(nullptr);
+
+    if(!fn)
+    {
+        std::cout << "Unknown command " << command.str() << ". Type :help for a list of commands.\n";
+        return true;
+    }
+    return (this->*fn)(args);
+}
+
+bool REPL::PrintRemarksCommand(llvm::StringRef)
+{
+    if(!m_optimize)
+    {
+        std::cout << "Optimization remarks are only collected when optimizations are enabled (--optimize=true)\n";
+        return true;
+    }
+    PrintRemarks(m_remarks, m_src_mgr);
+    return true;
+}
+
+swift::NominalTypeDecl *REPL::LookupNominalType(llvm::StringRef name)
+{
+    if(swift::ValueDecl *decl = LookupDecl(name.str()))
+        return llvm::dyn_cast<swift::NominalTypeDecl>(decl);
+
+    llvm::SmallVector<swift::ValueDecl *, 1> lookup_result;
+    for(auto *file : m_ast_ctx->getStdlibModule(true)->getFiles())
+        file->lookupValue({}, m_ast_ctx->getIdentifier(name), swift::NLKind::QualifiedLookup, lookup_result);
+    for(swift::ValueDecl *decl : lookup_result)
+    {
+        if(auto *nominal = llvm::dyn_cast<swift::NominalTypeDecl>(decl))
+            return nominal;
+    }
+    return nullptr;
+}
+
+// Rather than reimplementing IRGen's type layout, we generate a snippet that asks
+// the runtime through MemoryLayout, which is what the compiled code will actually use.
+// The AST is only used to enumerate the stored fields so we can compute offsets and padding.
+bool REPL::LayoutCommand(llvm::StringRef args)
+{
+    if(args.empty())
+    {
+        std::cout << "Usage: :layout Type\n";
+        return true;
+    }
+
+    std::string type = args.str();
+    llvm::StringRef base_name = args.split('<').first.trim();
+    swift::NominalTypeDecl *nominal = LookupNominalType(base_name);
+    if(!nominal)
+    {
+        std::cout << "Unknown type " << type << "\n";
+        return true;
+    }
+
+    std::string snippet;
+    llvm::raw_string_ostream stream(snippet);
+    stream << "do {\n"
+           << "func __layout_field_size<Root, Value>(_ key_path: KeyPath<Root, Value>) -> Int { return MemoryLayout<Value>.size }\n"
+           << "let size = MemoryLayout<" << type << ">.size\n"
+           << "let stride = MemoryLayout<" << type << ">.stride\n"
+           << "print(\"" << type << "\")\n"
+           << "print(\"  size: \\(size), stride: \\(stride), alignment: \\(MemoryLayout<" << type << ">.alignment)\")\n"
+           << "print(\"  trivially copyable: \\(_isPOD(" << type << ".self)), bitwise-takable: \\(_isBitwiseTakable(" << type << ".self))\")\n";
+
+    if(llvm::isa<swift::ClassDecl>(nominal))
+    {
+        stream << "print(\"  (class: layout is of the reference, fields live in the heap object)\")\n";
+    }
+    else if(llvm::isa<swift::StructDecl>(nominal) && !nominal->isGenericContext())
+    {
+        // Implicit storage (lazy and property wrapper backing variables) and fields that
+        // a key path outside the type can't name have no offset to ask for. Their bytes
+        // would show up as padding, so the breakdown is left out for types that have any.
+        std::vector<std::string> fields;
+        size_t hidden_fields = 0;
+        for(swift::VarDecl *field : nominal->getStoredProperties())
+        {
+            std::string name = field->getName().str();
+            if(field->isImplicit() || StartsWith(name, "$") ||
+               field->getFormalAccess() < swift::AccessLevel::Public)
+                hidden_fields++;
+            else
+                fields.push_back(name);
+        }
+        if(hidden_fields != 0)
+        {
+            stream << "print(\"  " << hidden_fields << " stored field(s) can't be seen from the REPL, "
+                   << "so there is no field breakdown\")\n";
+        }
+        else
+        {
+            stream << "let fields: [(String, Int?, Int)] = [\n";
+            for(const std::string &name : fields)
+            {
+                stream << "(\"" << name << "\", MemoryLayout<" << type << ">.offset(of: \\" << type << "." << name << "), "
+                       << "__layout_field_size(\\" << type << "." << name << ")),\n";
+            }
+            stream << "]\n"
+                   << "var end = 0\n"
+                   << "var padding = 0\n"
+                   << "for (name, offset, field_size) in fields.sorted(by: { ($0.1 ?? 0) < ($1.1 ?? 0) }) {\n"
+                   << "    guard let offset = offset else { print(\"  \\(name): not stored inline\"); continue }\n"
+                   << "    if offset > end { print(\"  [\\(end)..<\\(offset)] padding (\\(offset - end) bytes)\"); padding += offset - end }\n"
+                   << "    print(\"  [\\(offset)..<\\(offset + field_size)] \\(name) (\\(field_size) bytes)\")\n"
+                   << "    end = max(end, offset + field_size)\n"
+                   << "}\n"
+                   << "if size > end { print(\"  [\\(end)..<\\(size)] padding (\\(size - end) bytes)\"); padding += size - end }\n"
+                   << "print(\"  padding: \\(padding) bytes, tail padding in stride: \\(stride - size) bytes\")\n";
+        }
+    }
+    stream << "}\n";
+    stream.flush();
+
+    SetCurrentLoggingArea(LoggingArea::AST);
+    Log("Layout snippet:\n" + snippet);
+    return ExecuteSwift(snippet);
+}
+
+// Type-checks without generating code, executing or declaring anything
+bool REPL::CheckCommand(llvm::StringRef args)
+{
+    if(args.empty())
+    {
+        std::cout << "Usage: :check code\n";
+        return true;
+    }
+    if(CheckSwift(args.str()))
+        std::cout << "No errors\n";
+    return true;
+}
+
+// The file is memory-mapped rather than read, and executed as a single input whose
+// declarations are compiled together instead of in a module each. Functions in it can
+// still be redeclared, but with --optimize calls between them may have been inlined.
+bool REPL::LoadCommand(llvm::StringRef args)
+{
+    if(args.empty())
+    {
+        std::cout << "Usage: :load path.swift\n";
+        return true;
+    }
+
+    std::string path = args.str();
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path);
+    if(!buffer)
+    {
+        std::cout << "Failed to read " << path << ": " << buffer.getError().message() << "\n";
+        return true;
+    }
+    StartInput();
+    return ExecuteInput(AddToSrcMgr(std::move(*buffer)), true);
+}
+
+// Object files are linked right away; archive members as symbols they define are
+// looked up. Swift code in them is imported like any other module, through its
+// .swiftmodule on the module search path.
+bool REPL::LinkCommand(llvm::StringRef args)
+{
+    if(args.empty())
+    {
+        std::cout << "Usage: :link path.o or :link path.a\n";
+        return true;
+    }
+
+    std::string path = args.str();
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path);
+    if(!buffer)
+    {
+        std::cout << "Failed to read " << path << ": " << buffer.getError().message() << "\n";
+        return true;
+    }
+    bool linked;
+    switch(llvm::identify_magic((*buffer)->getBuffer()))
+    {
+    case llvm::file_magic::archive:
+        linked = m_jit->AddArchive(std::move(*buffer));
+        break;
+    case llvm::file_magic::elf_relocatable:
+    case llvm::file_magic::macho_object:
+    case llvm::file_magic::coff_object:
+        linked = m_jit->AddObjectFile(std::move(*buffer));
+        break;
+    default:
+        std::cout << path << " is not an object file or a static archive\n";
+        return true;
+    }
+    if(!linked)
+        std::cout << "Failed to link " << path << "\n";
+    return true;
+}
+
+// An output ending in .o (or .obj) is written as an object file, anything else as a
+// shared library linked by swiftc. Name.swiftmodule goes next to it, where Name is
+// the output's file name without its extension and library prefix.
+bool REPL::ExportCommand(llvm::StringRef args)
+{
+    if(args.empty())
+    {
+        std::cout << "Usage: :export path" << DYLIB_EXTENSION << " or :export path.o\n";
+        return true;
+    }
+
+    std::string path = args.str();
+    llvm::StringRef extension = llvm::sys::path::extension(path);
+    bool is_object = extension == ".o" || extension == ".obj";
+    llvm::StringRef module_name = llvm::sys::path::stem(path);
+    if(!is_object)
+        module_name.consume_front(DYLIB_PREFIX);
+    if(!swift::Lexer::isIdentifier(module_name))
+    {
+        std::cout << module_name.str() << " is not a valid module name\n";
+        return true;
+    }
+    llvm::SmallString<128> module_path(path);
+    llvm::sys::path::remove_filename(module_path);
+    llvm::sys::path::append(module_path, module_name + ".swiftmodule");
+
+    std::string object_path = path;
+    if(!is_object)
+    {
+        llvm::SmallString<128> temp_path;
+        if(std::error_code error = llvm::sys::fs::createTemporaryFile("swift-repl-export", "o", temp_path))
+        {
+            std::cout << "Failed to create a temporary file: " << error.message() << "\n";
+            return true;
+        }
+        object_path = temp_path.str();
+    }
+
+    StartInput();
+    bool compiled = CompileLiveDeclarations(module_name.str(), object_path, module_path.str().str());
+    if(compiled && !is_object)
+    {
+        llvm::ErrorOr<std::string> swiftc = llvm::sys::findProgramByName("swiftc", { SWIFT_BIN_DIR });
+        if(!swiftc)
+        {
+            std::cout << "Failed to find swiftc in " << SWIFT_BIN_DIR << "\n";
+            compiled = false;
+        }
+        else
+        {
+            llvm::StringRef link_args[] = { *swiftc, "-emit-library", "-module-name", module_name, "-o", path, object_path };
+            std::string error;
+            if(llvm::sys::ExecuteAndWait(*swiftc, link_args, llvm::None, {}, 0, 0, &error) != 0)
+            {
+                std::cout << "Failed to link " << path << (error.empty() ? "" : ": " + error) << "\n";
+                compiled = false;
+            }
+        }
+    }
+    if(!is_object)
+        llvm::sys::fs::remove(object_path);
+    if(compiled)
+        std::cout << "Exported " << module_name.str() << " to " << path << " and " << module_path.str().str() << "\n";
+    return true;
+}
+
+// Maps a file read-only and declares a global UnsafeBufferPointer over it, so the
+// data is paged in as the code reading it touches it instead of being copied or
+// parsed. The mapping lives as long as the REPL.
+bool REPL::MapCommand(llvm::StringRef args)
+{
+    llvm::StringRef name, path, type;
+    std::tie(name, path) = args.split('=');
+    std::tie(path, type) = path.rsplit(" as ");
+    name = name.trim();
+    path = path.trim();
+    type = type.trim();
+    if(name.empty() || path.empty() || !type.consume_front("[") || !type.consume_back("]"))
+    {
+        std::cout << "Usage: :map name = path as [Type]\n";
+        return true;
+    }
+    type = type.trim();
+
+    // Only types for which every bit pattern is a valid value
+    size_t stride = llvm::StringSwitch<size_t>(type)
+        .Cases("Int", "UInt", "Int64", "UInt64", "Double", 8)
+        .Cases("Int32", "UInt32", "Float", 4)
+        .Cases("Int16", "UInt16", 2)
+        .Cases("Int8", "UInt8", 1)
+        .Default(0);
+    if(stride == 0)
+    {
+        std::cout << "Can't map " << type.str() << ". Supported types are Int, UInt, their sized variants, Float and Double\n";
+        return true;
+    }
+    if(m_decl_map.find(name.str()) != m_decl_map.end())
+    {
+        std::cout << "Invalid redeclaration of " << name.str() << "\n";
+        m_input_rejected = true;
+        return true;
+    }
+
+    // mapped_file_region takes a HANDLE on Windows, so this can't be a file descriptor
+    uint64_t file_size;
+    std::error_code ec = llvm::sys::fs::file_size(path, file_size);
+    if(ec)
+    {
+        std::cout << "Failed to open " << path.str() << ": " << ec.message() << "\n";
+        return true;
+    }
+    llvm::Expected<llvm::sys::fs::file_t> file = llvm::sys::fs::openNativeFileForRead(path);
+    if(!file)
+    {
+        std::cout << "Failed to open " << path.str() << ": " << llvm::toString(file.takeError()) << "\n";
+        return true;
+    }
+    if(file_size % stride != 0)
+    {
+        llvm::sys::fs::closeFile(*file);
+        std::cout << path.str() << " is " << file_size << " bytes, which isn't a multiple of the size of "
+                  << type.str() << " (" << stride << " bytes)\n";
+        return true;
+    }
+
+    // Mapping an empty file fails, and there is nothing to point at anyway
+    std::uintptr_t address = 0;
+    std::unique_ptr<llvm::sys::fs::mapped_file_region> region;
+    if(file_size != 0)
+    {
+        region = std::make_unique<llvm::sys::fs::mapped_file_region>(
+            *file, llvm::sys::fs::mapped_file_region::readonly, file_size, 0, ec);
+        if(ec)
+        {
+            llvm::sys::fs::closeFile(*file);
+            std::cout << "Failed to map " << path.str() << ": " << ec.message() << "\n";
+            return true;
+        }
+        address = reinterpret_cast<std::uintptr_t>(region->const_data());
+    }
+    llvm::sys::fs::closeFile(*file);
+
+    std::string snippet;
+    llvm::raw_string_ostream stream(snippet);
+    stream << "let " << name << " = UnsafeBufferPointer<" << type << ">("
+           << "start: UnsafePointer<" << type << ">(bitPattern: " << address << "), "
+           << "count: " << file_size / stride << ")\n";
+    stream.flush();
+
+    SetCurrentLoggingArea(LoggingArea::AST);
+    Log("Map snippet:\n" + snippet);
+    bool keep_going = ExecuteSwift(snippet);
+    if(!LastInputHadError() && region)
+        m_mapped_files.push_back(std::move(region));
+    return keep_going;
+}
+
+// first_lines are lines that came with the begin command, like in
+// ":sil-begin\n...\n:sil-end\nswift code", which are handled as if they had been
+// entered one at a time
+bool REPL::BeginRawBlock(llvm::StringRef end_command, RawBlockFn execute, llvm::StringRef first_lines)
+{
+    m_raw_block = RawBlock{ end_command.str(), execute, "" };
+    while(m_raw_block && !first_lines.empty())
+    {
+        llvm::StringRef line;
+        std::tie(line, first_lines) = first_lines.split('\n');
+        if(!AddToRawBlock(line))
+            return false;
+    }
+    if(!first_lines.trim().empty())
+        return ExecuteSwift(first_lines);
+    return true;
+}
+
+bool REPL::AddToRawBlock(llvm::StringRef line)
+{
+    assert(m_raw_block);
+    if(line.trim() != m_raw_block->end_command)
+    {
+        m_raw_block->text += line;
+        m_raw_block->text += "\n";
+        return true;
+    }
+    RawBlock block = std::move(*m_raw_block);
+    m_raw_block.reset();
+    return (this->*block.execute)(block.text);
+}
+
+// Only reached outside of a block; inside one, ExecuteSwift hands the end command to the block
+bool REPL::RawBlockEndCommand(llvm::StringRef)
+{
+    std::cout << "There is no block to end\n";
+    return true;
+}
+
+bool REPL::SILBeginCommand(llvm::StringRef args)
+{
+    return BeginRawBlock(":sil-end", &REPL::ExecuteSIL, args);
+}
+
+bool REPL::LLVMBeginCommand(llvm::StringRef args)
+{
+    return BeginRawBlock(":llvm-end", &REPL::ExecuteLLVMIR, args);
+}
+
+bool REPL::CBeginCommand(llvm::StringRef args)
+{
+    return BeginRawBlock(":c-end", &REPL::ExecuteC, args);
+}
+
+bool REPL::HelpCommand(llvm::StringRef)
+{
+    std::cout << ":c-begin       Compile the following lines, up to :c-end, as C and import them\n"
+              << ":check code    Type-check code without running it or keeping its declarations\n"
+              << ":export path   Compile the session's declarations with -O into a library or object file\n"
+              << ":help          Show this message\n"
+              << ":layout Type   Show size, stride, alignment and field layout of a type\n"
+              << ":link path     Link an object file or static archive into the session\n"
+              << ":llvm-begin    Execute the following lines, up to :llvm-end, as LLVM IR\n"
+              << ":load path     Execute a Swift file, compiling its declarations together\n"
+              << ":map name = path as [Type]\n"
+              << "               Declare name as an UnsafeBufferPointer<Type> over a memory-mapped file\n"
+              << ":remarks       Show optimization remarks for the last input\n"
+              << ":sil-begin     Execute the following lines, up to :sil-end, as SIL\n";
+    return true;
+}
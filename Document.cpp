@@ -0,0 +1,357 @@
+#include "Document.h"
+
+#include <algorithm>
+#include <cassert>
+
+constexpr int Document::Null;
+
+Document::Document()
+    : m_root(Null),
+      m_random_state(0x9E3779B9)
+{
+}
+
+Document::Document(std::string text)
+    : Document()
+{
+    Buffer &original = m_buffers[Original];
+    original.text = std::move(text);
+    for(size_t i = 0; i < original.text.size(); i++)
+    {
+        if(original.text[i] == '\n')
+            original.newlines.push_back(i);
+    }
+    if(!original.text.empty())
+        m_root = NewNode(MakePiece(Original, 0, original.text.size()));
+}
+
+int Document::NewNode(const Piece &piece)
+{
+    // xorshift32, treap priorities only need to be roughly uniform
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+
+    Node node = { piece, m_random_state, Null, Null, piece.length, piece.newlines };
+    if(!m_free_nodes.empty())
+    {
+        int index = m_free_nodes.back();
+        m_free_nodes.pop_back();
+        m_nodes[index] = node;
+        return index;
+    }
+    m_nodes.push_back(node);
+    return static_cast<int>(m_nodes.size() - 1);
+}
+
+void Document::FreeNode(int node)
+{
+    m_free_nodes.push_back(node);
+}
+
+void Document::FreeTree(int node)
+{
+    if(node == Null)
+        return;
+    FreeTree(m_nodes[node].left);
+    FreeTree(m_nodes[node].right);
+    FreeNode(node);
+}
+
+void Document::Update(int node)
+{
+    Node &n = m_nodes[node];
+    n.subtree_length = n.piece.length;
+    n.subtree_newlines = n.piece.newlines;
+    if(n.left != Null)
+    {
+        n.subtree_length += m_nodes[n.left].subtree_length;
+        n.subtree_newlines += m_nodes[n.left].subtree_newlines;
+    }
+    if(n.right != Null)
+    {
+        n.subtree_length += m_nodes[n.right].subtree_length;
+        n.subtree_newlines += m_nodes[n.right].subtree_newlines;
+    }
+}
+
+// Splits the tree rooted at node into the first offset characters and the rest,
+// splitting a piece in two if offset falls inside of it.
+void Document::Split(int node, size_t offset, int &left, int &right)
+{
+    if(node == Null)
+    {
+        left = right = Null;
+        return;
+    }
+
+    int node_left = m_nodes[node].left;
+    size_t left_length = node_left == Null ? 0 : m_nodes[node_left].subtree_length;
+    Piece piece = m_nodes[node].piece;
+    if(offset <= left_length)
+    {
+        int split_right;
+        Split(node_left, offset, left, split_right);
+        m_nodes[node].left = split_right;
+        Update(node);
+        right = node;
+    }
+    else if(offset >= left_length + piece.length)
+    {
+        int split_left;
+        Split(m_nodes[node].right, offset - left_length - piece.length, split_left, right);
+        m_nodes[node].right = split_left;
+        Update(node);
+        left = node;
+    }
+    else
+    {
+        size_t split_at = offset - left_length;
+        int second = NewNode(MakePiece(piece.buffer, piece.start + split_at, piece.length - split_at));
+        int node_right = m_nodes[node].right;
+        m_nodes[node].piece = MakePiece(piece.buffer, piece.start, split_at);
+        m_nodes[node].right = Null;
+        Update(node);
+        left = node;
+        right = Merge(second, node_right);
+    }
+}
+
+int Document::Merge(int left, int right)
+{
+    if(left == Null)
+        return right;
+    if(right == Null)
+        return left;
+
+    if(m_nodes[left].priority > m_nodes[right].priority)
+    {
+        int merged = Merge(m_nodes[left].right, right);
+        m_nodes[left].right = merged;
+        Update(left);
+        return left;
+    }
+    int merged = Merge(left, m_nodes[right].left);
+    m_nodes[right].left = merged;
+    Update(right);
+    return right;
+}
+
+int Document::Rightmost(int node) const
+{
+    while(node != Null && m_nodes[node].right != Null)
+        node = m_nodes[node].right;
+    return node;
+}
+
+size_t Document::CountNewlines(BufferKind buffer, size_t start, size_t length) const
+{
+    const std::vector<size_t> &newlines = m_buffers[buffer].newlines;
+    auto first = std::lower_bound(newlines.begin(), newlines.end(), start);
+    auto last = std::lower_bound(first, newlines.end(), start + length);
+    return static_cast<size_t>(last - first);
+}
+
+Document::Piece Document::MakePiece(BufferKind buffer, size_t start, size_t length) const
+{
+    return { buffer, start, length, CountNewlines(buffer, start, length) };
+}
+
+void Document::Insert(size_t offset, const std::string &text)
+{
+    if(text.empty())
+        return;
+    offset = std::min(offset, Size());
+
+    Buffer &added = m_buffers[Added];
+    size_t start = added.text.size();
+    added.text += text;
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        if(text[i] == '\n')
+            added.newlines.push_back(start + i);
+    }
+
+    int left, right;
+    Split(m_root, offset, left, right);
+
+    // Typing usually appends to the piece that the previous keystroke created
+    int last = Rightmost(left);
+    if(last != Null &&
+       m_nodes[last].piece.buffer == Added &&
+       m_nodes[last].piece.start + m_nodes[last].piece.length == start)
+    {
+        int rest, last_only;
+        Split(left, m_nodes[left].subtree_length - m_nodes[last].piece.length, rest, last_only);
+        assert(last_only == last);
+        Piece &piece = m_nodes[last].piece;
+        piece = MakePiece(Added, piece.start, piece.length + text.size());
+        Update(last);
+        left = Merge(rest, last);
+    }
+    else
+    {
+        left = Merge(left, NewNode(MakePiece(Added, start, text.size())));
+    }
+    m_root = Merge(left, right);
+}
+
+void Document::Erase(size_t offset, size_t length)
+{
+    size_t size = Size();
+    if(offset >= size || length == 0)
+        return;
+    length = std::min(length, size - offset);
+
+    int left, middle, right;
+    Split(m_root, offset, left, middle);
+    Split(middle, length, middle, right);
+    FreeTree(middle);
+    m_root = Merge(left, right);
+}
+
+void Document::Replace(size_t offset, size_t length, const std::string &text)
+{
+    Erase(offset, length);
+    Insert(offset, text);
+}
+
+size_t Document::Size() const
+{
+    return m_root == Null ? 0 : m_nodes[m_root].subtree_length;
+}
+
+size_t Document::LineCount() const
+{
+    return (m_root == Null ? 0 : m_nodes[m_root].subtree_newlines) + 1;
+}
+
+size_t Document::LineStart(size_t line) const
+{
+    if(line == 0)
+        return 0;
+
+    // Find the line-th newline; the line starts right after it
+    size_t newline = line;
+    size_t offset = 0;
+    int node = m_root;
+    while(node != Null)
+    {
+        const Node &n = m_nodes[node];
+        size_t left_length = n.left == Null ? 0 : m_nodes[n.left].subtree_length;
+        size_t left_newlines = n.left == Null ? 0 : m_nodes[n.left].subtree_newlines;
+        if(newline <= left_newlines)
+        {
+            node = n.left;
+            continue;
+        }
+        newline -= left_newlines;
+        offset += left_length;
+        if(newline <= n.piece.newlines)
+        {
+            const std::vector<size_t> &newlines = m_buffers[n.piece.buffer].newlines;
+            auto first = std::lower_bound(newlines.begin(), newlines.end(), n.piece.start);
+            return offset + (*(first + (newline - 1)) - n.piece.start) + 1;
+        }
+        newline -= n.piece.newlines;
+        offset += n.piece.length;
+        node = n.right;
+    }
+    return Size();
+}
+
+size_t Document::LineOfOffset(size_t offset) const
+{
+    size_t line = 0;
+    int node = m_root;
+    while(node != Null)
+    {
+        const Node &n = m_nodes[node];
+        size_t left_length = n.left == Null ? 0 : m_nodes[n.left].subtree_length;
+        if(offset <= left_length)
+        {
+            node = n.left;
+            continue;
+        }
+        line += n.left == Null ? 0 : m_nodes[n.left].subtree_newlines;
+        offset -= left_length;
+        if(offset <= n.piece.length)
+            return line + CountNewlines(n.piece.buffer, n.piece.start, offset);
+        line += n.piece.newlines;
+        offset -= n.piece.length;
+        node = n.right;
+    }
+    return line;
+}
+
+char Document::CharAt(size_t offset) const
+{
+    int node = m_root;
+    while(node != Null)
+    {
+        const Node &n = m_nodes[node];
+        size_t left_length = n.left == Null ? 0 : m_nodes[n.left].subtree_length;
+        if(offset < left_length)
+        {
+            node = n.left;
+            continue;
+        }
+        offset -= left_length;
+        if(offset < n.piece.length)
+            return m_buffers[n.piece.buffer].text[n.piece.start + offset];
+        offset -= n.piece.length;
+        node = n.right;
+    }
+    return '\0';
+}
+
+void Document::AppendPieceText(const Piece &piece, size_t offset, size_t length, std::string &out) const
+{
+    out.append(m_buffers[piece.buffer].text, piece.start + offset, length);
+}
+
+// offset is how many characters still need to be skipped, length how many still need to be copied
+void Document::AppendText(int node, size_t &offset, size_t &length, std::string &out) const
+{
+    if(node == Null || length == 0)
+        return;
+
+    const Node &n = m_nodes[node];
+    size_t left_length = n.left == Null ? 0 : m_nodes[n.left].subtree_length;
+    if(offset < left_length)
+        AppendText(n.left, offset, length, out);
+    else
+        offset -= left_length;
+
+    if(length == 0)
+        return;
+    if(offset < n.piece.length)
+    {
+        size_t count = std::min(n.piece.length - offset, length);
+        AppendPieceText(n.piece, offset, count, out);
+        length -= count;
+        offset = 0;
+    }
+    else
+    {
+        offset -= n.piece.length;
+    }
+    AppendText(n.right, offset, length, out);
+}
+
+std::string Document::GetText() const
+{
+    return GetText(0, Size());
+}
+
+std::string Document::GetText(size_t offset, size_t length) const
+{
+    std::string result;
+    size_t size = Size();
+    if(offset >= size)
+        return result;
+    length = std::min(length, size - offset);
+    result.reserve(length);
+    AppendText(m_root, offset, length, result);
+    return result;
+}
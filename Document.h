@@ -0,0 +1,92 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A piece table for the playground's document. The text is never copied on edits:
+// it lives in the original buffer and an append-only buffer of inserted text, and the
+// document is a sequence of pieces referring to ranges of those buffers.
+//
+// Pieces are kept in a treap ordered by position, where every node knows the length
+// and newline count of its subtree, and both buffers keep the offsets of their
+// newlines. So edits cost O(edit size + log(pieces)), and so do conversions between
+// offsets and line numbers. Lines are separated by '\n'.
+class Document
+{
+public:
+    Document();
+    explicit Document(std::string text);
+
+    void Insert(size_t offset, const std::string &text);
+    void Erase(size_t offset, size_t length);
+    void Replace(size_t offset, size_t length, const std::string &text);
+
+    size_t Size() const;
+    size_t LineCount() const;
+    // Offset of the first character of a 0-based line. Returns Size() past the last line.
+    size_t LineStart(size_t line) const;
+    // 0-based line containing an offset
+    size_t LineOfOffset(size_t offset) const;
+    char CharAt(size_t offset) const;
+
+    std::string GetText() const;
+    std::string GetText(size_t offset, size_t length) const;
+
+private:
+    enum BufferKind : uint8_t
+    {
+        Original,
+        Added,
+    };
+
+    struct Piece
+    {
+        BufferKind buffer;
+        size_t start;
+        size_t length;
+        size_t newlines;
+    };
+
+    struct Node
+    {
+        Piece piece;
+        uint32_t priority;
+        int left;
+        int right;
+        size_t subtree_length;
+        size_t subtree_newlines;
+    };
+
+    struct Buffer
+    {
+        std::string text;
+        // Sorted offsets of every '\n' in text
+        std::vector<size_t> newlines;
+    };
+
+    static constexpr int Null = -1;
+
+    int NewNode(const Piece &piece);
+    void FreeNode(int node);
+    void Update(int node);
+    void Split(int node, size_t offset, int &left, int &right);
+    int Merge(int left, int right);
+    void FreeTree(int node);
+    int Rightmost(int node) const;
+
+    size_t CountNewlines(BufferKind buffer, size_t start, size_t length) const;
+    Piece MakePiece(BufferKind buffer, size_t start, size_t length) const;
+    void AppendPieceText(const Piece &piece, size_t offset, size_t length, std::string &out) const;
+    void AppendText(int node, size_t &offset, size_t &length, std::string &out) const;
+
+    Buffer m_buffers[2];
+    std::vector<Node> m_nodes;
+    std::vector<int> m_free_nodes;
+    int m_root;
+    uint32_t m_random_state;
+};
+
+#endif
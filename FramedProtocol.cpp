@@ -0,0 +1,69 @@
+#include "FramedProtocol.h"
+
+static void AppendInteger(std::string &out, uint64_t value, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static void AppendBytes(std::string &out, const std::string &bytes)
+{
+    AppendInteger(out, bytes.size(), 4);
+    out += bytes;
+}
+
+static uint8_t DiagnosticKindCode(swift::DiagnosticKind kind)
+{
+    switch(kind)
+    {
+    case swift::DiagnosticKind::Error:
+        return 0;
+    case swift::DiagnosticKind::Warning:
+        return 1;
+    case swift::DiagnosticKind::Remark:
+        return 2;
+    case swift::DiagnosticKind::Note:
+        return 3;
+    }
+    return 0;
+}
+
+bool ReadFrame(std::istream &in, std::string &payload)
+{
+    unsigned char header[4];
+    if(!in.read(reinterpret_cast<char *>(header), sizeof(header)))
+        return false;
+
+    uint32_t size = 0;
+    for(size_t i = 0; i < sizeof(header); i++)
+        size |= static_cast<uint32_t>(header[i]) << (8 * i);
+    payload.resize(size);
+    return size == 0 || in.read(&payload[0], size);
+}
+
+std::string EncodeResponse(const FramedResponse &response)
+{
+    size_t diagnostics_size = 0;
+    for(const REPL::Diagnostic &diagnostic : response.diagnostics)
+        diagnostics_size += 1 + 4 + 4 + 4 + diagnostic.message.size();
+
+    // The length goes in front once the payload is written
+    std::string frame(4, '\0');
+    frame.reserve(4 + 1 + 8 + 4 + response.output.size() + 4 + diagnostics_size);
+    AppendInteger(frame, static_cast<uint8_t>(response.status), 1);
+    AppendInteger(frame, response.duration_us, 8);
+    AppendBytes(frame, response.output);
+    AppendInteger(frame, response.diagnostics.size(), 4);
+    for(const REPL::Diagnostic &diagnostic : response.diagnostics)
+    {
+        AppendInteger(frame, DiagnosticKindCode(diagnostic.kind), 1);
+        AppendInteger(frame, diagnostic.line, 4);
+        AppendInteger(frame, diagnostic.column, 4);
+        AppendBytes(frame, diagnostic.message);
+    }
+
+    uint64_t payload_size = frame.size() - 4;
+    for(size_t i = 0; i < 4; i++)
+        frame[i] = static_cast<char>((payload_size >> (8 * i)) & 0xFF);
+    return frame;
+}
@@ -0,0 +1,49 @@
+#ifndef FRAMED_PROTOCOL_H
+#define FRAMED_PROTOCOL_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "REPL.h"
+
+// With --protocol=framed, swift-repl reads requests from stdin and writes responses to
+// stdout as frames: a little-endian uint32 payload length followed by the payload.
+// There are no prompts, and a response is written with a single write, so clients can
+// send many requests ahead and match responses to them by order.
+//
+// A request's payload is one input, exactly as it would be typed at the prompt.
+// Commands and several lines are allowed.
+//
+// A response's payload is, with integers in little-endian:
+//     u8   status          0 ok, 1 the input had errors, 2 the input exited the REPL
+//     u64  duration        microseconds spent executing the input
+//     u32  N, N bytes      everything the input wrote to stdout
+//     u32  diagnostic count, then for each diagnostic:
+//          u8   kind       0 error, 1 warning, 2 remark, 3 note
+//          u32  line       1-based, 0 if the diagnostic has no location
+//          u32  column
+//          u32  N, N bytes message
+
+enum class FramedStatus : uint8_t
+{
+    Ok = 0,
+    Error = 1,
+    Exited = 2,
+};
+
+struct FramedResponse
+{
+    FramedStatus status = FramedStatus::Ok;
+    uint64_t duration_us = 0;
+    std::string output;
+    std::vector<REPL::Diagnostic> diagnostics;
+};
+
+// Returns false at the end of the input or if it ends in the middle of a frame
+bool ReadFrame(std::istream &in, std::string &payload);
+// Returns the whole frame, length included
+std::string EncodeResponse(const FramedResponse &response);
+
+#endif
@@ -43,6 +43,81 @@ bool JIT::AddDylib(std::string name)
     return result;
 }
 
+bool JIT::AddObjectFile(std::unique_ptr<llvm::MemoryBuffer> buffer)
+{
+    SetCurrentLoggingArea(LoggingArea::JIT);
+    std::string name = buffer->getBufferIdentifier().str();
+    if(llvm::Error error = m_object_layer.add(m_execution_session.getMainJITDylib(), std::move(buffer)))
+    {
+        Log("Failed to add object file " + name + ": " + llvm::toString(std::move(error)),
+            LoggingPriority::Warning);
+        return false;
+    }
+    Log("Added object file " + name);
+    return true;
+}
+
+bool JIT::AddArchive(std::unique_ptr<llvm::MemoryBuffer> buffer)
+{
+    SetCurrentLoggingArea(LoggingArea::JIT);
+    std::string name = buffer->getBufferIdentifier().str();
+    llvm::Expected<std::unique_ptr<llvm::object::Archive>> archive =
+        llvm::object::Archive::create(buffer->getMemBufferRef());
+    if(!archive)
+    {
+        Log("Failed to read archive " + name + ": " + llvm::toString(archive.takeError()),
+            LoggingPriority::Warning);
+        return false;
+    }
+    if(!(*archive)->hasSymbolTable())
+    {
+        Log("Archive " + name + " has no symbol table", LoggingPriority::Warning);
+        return false;
+    }
+    m_archives.push_back({ std::move(buffer), std::move(*archive) });
+    Log("Added archive " + name);
+    return true;
+}
+
+bool JIT::AddArchiveMembersDefining(llvm::StringRef name)
+{
+    bool added = false;
+    for(StaticArchive &archive : m_archives)
+    {
+        llvm::Expected<llvm::Optional<llvm::object::Archive::Child>> member = archive.archive->findSym(name);
+        if(!member)
+        {
+            Log(llvm::toString(member.takeError()), LoggingPriority::Warning);
+            continue;
+        }
+        if(!*member)
+            continue;
+        llvm::Expected<llvm::MemoryBufferRef> member_buffer = (*member)->getMemoryBufferRef();
+        if(!member_buffer)
+        {
+            Log(llvm::toString(member_buffer.takeError()), LoggingPriority::Warning);
+            continue;
+        }
+        // A member defining several symbols is only added for the first one
+        if(!m_added_archive_members.insert(member_buffer->getBufferStart()).second)
+            continue;
+        // The archive outlives the JIT's use of the member, so it isn't copied
+        added |= AddObjectFile(llvm::MemoryBuffer::getMemBuffer(*member_buffer, false));
+    }
+    return added;
+}
+
+void JIT::AddAbsoluteSymbol(llvm::StringRef symbol_name, void *address)
+{
+    SetCurrentLoggingArea(LoggingArea::JIT);
+    Log(std::string("Defining host symbol ") + symbol_name.str());
+    orc::SymbolMap symbols;
+    symbols[m_mangler(symbol_name.str())] =
+        llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(address),
+                                 llvm::JITSymbolFlags::Exported);
+    llvm::cantFail(m_execution_session.getMainJITDylib().define(orc::absoluteSymbols(std::move(symbols))));
+}
+
 llvm::Expected<llvm::JITEvaluatedSymbol> JIT::LookupSymbol(llvm::StringRef symbol_name)
 {
     SetCurrentLoggingArea(LoggingArea::JIT);
@@ -62,15 +137,19 @@ orc::SymbolNameSet JIT::SymbolGenerator::operator()(orc::JITDylib &jd, const orc
 {
     orc::SymbolNameSet imps;
     orc::SymbolNameSet non_imps;
+    orc::SymbolNameSet added;
     for(auto &name : names)
     {
         if((*name).startswith("__imp_"))
             imps.insert(name);
+        else if(m_jit.AddArchiveMembersDefining(*name))
+            added.insert(name);
         else
             non_imps.insert(name);
     }
 
-    orc::SymbolNameSet added = m_search(jd, non_imps);
+    for(auto &name : m_search(jd, non_imps))
+        added.insert(name);
     orc::SymbolMap new_symbols;
 
     for(auto &_imp : imps)
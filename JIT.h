@@ -9,6 +9,10 @@
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
 #include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/Object/Archive.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <unordered_set>
 
 namespace orc = llvm::orc;
 
@@ -19,7 +23,16 @@ public:
     void AddSearchPath(std::string path);
     void AddModule(std::unique_ptr<llvm::Module> module);
     bool AddDylib(std::string absolute_path);
+    // Adds a relocatable object file, like one built ahead of time by swiftc or clang.
+    // Returns false if it can't be added, like when it redefines a symbol.
+    bool AddObjectFile(std::unique_ptr<llvm::MemoryBuffer> buffer);
+    // Members of a static archive are added as object files the first time a symbol
+    // they define is looked up and not already defined
+    bool AddArchive(std::unique_ptr<llvm::MemoryBuffer> buffer);
+    // Defines a symbol at an address in the host process, for functions the JIT'd code calls back into
+    void AddAbsoluteSymbol(llvm::StringRef symbol_name, void *address);
     llvm::Expected<llvm::JITEvaluatedSymbol> LookupSymbol(llvm::StringRef symbol_name);
+    const llvm::DataLayout &GetDataLayout() const { return m_data_layout; }
     // NOTE(sasha): Returns SymbolsNotFound Error if the symbol was not found
     //              Returns SymbolsCouldNotBeRemoved on failure to actually remove the symbol
     //              Returns Error::success() on success, does nothing on failure.
@@ -42,7 +55,15 @@ private:
         JIT &m_jit;
     };
 
+    struct StaticArchive
+    {
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+        std::unique_ptr<llvm::object::Archive> archive;
+    };
+
     JIT(orc::JITTargetMachineBuilder machine_builder, llvm::DataLayout data_layout);
+    // Adds the members of m_archives that define name. Returns true if there were any.
+    bool AddArchiveMembersDefining(llvm::StringRef name);
 
     orc::ExecutionSession m_execution_session;
     orc::RTDyldObjectLinkingLayer m_object_layer;
@@ -53,5 +74,9 @@ private:
     orc::ThreadSafeContext m_ctx;
 
     SymbolGenerator m_generator;
+
+    std::vector<StaticArchive> m_archives;
+    // Members already added, by the start of their data
+    std::unordered_set<const char *> m_added_archive_members;
 };
 #endif
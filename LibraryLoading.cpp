@@ -26,7 +26,7 @@ bool SearchForAndLoadLibraryPermanently(std::string name)
 {
     // NOTE(sasha): For some strange reason, LLVM's LoadLibraryPermanently returns true
     //              on failure and false on success, so we negate its result.
-    name += DYLIB_EXTENSION;
+    name = DYLIB_PREFIX + name + DYLIB_EXTENSION;
     if(!llvm::sys::DynamicLibrary::LoadLibraryPermanently(name.c_str()))
         return true;
 
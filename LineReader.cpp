@@ -0,0 +1,148 @@
+#include "LineReader.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define read _read
+#else
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#define MAX_READ_SIZE 0x10000
+
+LineReader::LineReader(int fd)
+    : m_fd(fd)
+{
+}
+
+bool LineReader::ReadLine(std::string &line)
+{
+    while(!HasBufferedLine() && !m_eof)
+        Fill(-1);
+
+    if(m_start == m_buffer.size())
+        return false;
+
+    size_t end = m_buffer.find('\n', m_start);
+    size_t next = end == std::string::npos ? m_buffer.size() : end + 1;
+    if(end == std::string::npos)
+        end = m_buffer.size();
+    if(end > m_start && m_buffer[end - 1] == '\r')
+        end--;
+    line.assign(m_buffer, m_start, end - m_start);
+    m_start = next;
+
+    // Only compact once everything before it has been handed out, so that lines in a
+    // large paste aren't shifted one at a time
+    if(m_start == m_buffer.size())
+    {
+        m_buffer.clear();
+        m_start = 0;
+    }
+    return true;
+}
+
+bool LineReader::HasLine(std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while(!HasBufferedLine() && !m_eof)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if(remaining.count() <= 0)
+            return false;
+        if(!Fill(static_cast<int>(remaining.count())) && !m_eof)
+            return false;
+    }
+    return m_start != m_buffer.size();
+}
+
+bool LineReader::HasBufferedLine() const
+{
+    return m_buffer.find('\n', m_start) != std::string::npos;
+}
+
+#ifdef _WIN32
+// A console has a whole line once Enter is among the pending key presses. Anything
+// else in the input queue (focus or mouse events, a partly typed line) would leave
+// a read blocked.
+static bool ConsoleHasLine(HANDLE handle)
+{
+    DWORD count = 0;
+    if(!GetNumberOfConsoleInputEvents(handle, &count) || count == 0)
+        return false;
+
+    std::vector<INPUT_RECORD> records(count);
+    DWORD peeked = 0;
+    if(!PeekConsoleInputW(handle, records.data(), count, &peeked))
+        return false;
+    return std::any_of(records.begin(), records.begin() + peeked,
+                       [](const INPUT_RECORD &record)
+                       {
+                           return record.EventType == KEY_EVENT &&
+                               record.Event.KeyEvent.bKeyDown &&
+                               record.Event.KeyEvent.uChar.UnicodeChar == L'\r';
+                       });
+}
+
+static bool WaitForInput(int fd, int timeout_ms)
+{
+    if(timeout_ms < 0)
+        return true;
+
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+    DWORD type = GetFileType(handle);
+    if(type == FILE_TYPE_DISK)
+        return true;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    do
+    {
+        if(type == FILE_TYPE_PIPE)
+        {
+            DWORD available = 0;
+            // A failure means the other end was closed, which the read reports
+            if(!PeekNamedPipe(handle, nullptr, 0, nullptr, &available, nullptr) || available > 0)
+                return true;
+        }
+        else if(type == FILE_TYPE_CHAR)
+        {
+            if(ConsoleHasLine(handle))
+                return true;
+        }
+        else
+        {
+            return false;
+        }
+        Sleep(1);
+    } while(std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+#else
+static bool WaitForInput(int fd, int timeout_ms)
+{
+    pollfd poll_fd = { fd, POLLIN, 0 };
+    // POLLHUP without POLLIN still means the read will return, with end of input
+    return poll(&poll_fd, 1, timeout_ms) > 0;
+}
+#endif
+
+bool LineReader::Fill(int timeout_ms)
+{
+    if(!WaitForInput(m_fd, timeout_ms))
+        return false;
+
+    char buffer[MAX_READ_SIZE];
+    auto bytes_read = read(m_fd, buffer, MAX_READ_SIZE);
+    if(bytes_read <= 0)
+    {
+        m_eof = true;
+        return false;
+    }
+    m_buffer.append(buffer, static_cast<size_t>(bytes_read));
+    return true;
+}
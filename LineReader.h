@@ -0,0 +1,35 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <chrono>
+#include <string>
+
+// Reads lines straight from a file descriptor with its own buffer, so that it can tell
+// whether more lines are already waiting. std::cin can't: with stdio synchronization
+// its buffer is the C runtime's, and what it has already pulled in is invisible to poll().
+// This is what lets the REPL group a pasted block or piped input into larger inputs.
+class LineReader
+{
+public:
+    explicit LineReader(int fd = 0);
+
+    // Blocks until a whole line, or the rest of the input, is available. The newline
+    // (and a '\r' before it) is not included. Returns false at the end of the input.
+    bool ReadLine(std::string &line);
+    // Whether ReadLine would return without blocking, after waiting up to timeout for
+    // the rest of a line to arrive
+    bool HasLine(std::chrono::milliseconds timeout);
+
+private:
+    bool HasBufferedLine() const;
+    // Waits up to timeout_ms (forever if negative) for input and reads what is there.
+    // Returns false if nothing was read.
+    bool Fill(int timeout_ms);
+
+    const int m_fd;
+    std::string m_buffer;
+    size_t m_start = 0;
+    bool m_eof = false;
+};
+
+#endif
@@ -27,7 +27,9 @@ LoggingArea &operator |=(LoggingArea &l, LoggingArea r)
 }
 
 LoggingOptions g_log_opts;
-LoggingArea g_curr_logging_area;
+// Each thread has its own, since the playground's background checker runs a REPL on
+// a thread of its own
+thread_local LoggingArea g_curr_logging_area;
 
 const char *PriorityStrings[] = { "[INFO] ", "[WARNING] ", "[ERROR] ", "", "" };
 
@@ -20,7 +20,7 @@ enum class LoggingArea : uint64_t
     IR  = (1 << 2),
     JIT = (1 << 3),
     Importer = (1 << 4),
-    All = ~0,
+    All = ~0ull,
 };
 
 enum class LoggingPriority : uint64_t
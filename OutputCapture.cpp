@@ -0,0 +1,247 @@
+#include "OutputCapture.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#define close _close
+#define dup _dup
+#define dup2 _dup2
+#define read _read
+#else
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#define STDOUT_FD 1
+//NOTE(sasha): There are \Bigg{\emph{\textbf{SEVERE}}} performance issues if
+//             pipe buffer size is too small. We just pass the standard on Linux,
+//             which is 0xFFFF.
+#define PIPE_SIZE 0xFFFF
+#define MAX_READ_SIZE 0x10000
+#define POLL_INTERVAL_MS 10
+
+constexpr size_t OutputCapture::DefaultBufferSize;
+constexpr std::chrono::milliseconds OutputCapture::DefaultCoalesceInterval;
+
+OutputCapture::OutputCapture(size_t buffer_size, std::chrono::milliseconds coalesce_interval)
+    : m_ring(buffer_size),
+      m_coalesce_interval(coalesce_interval)
+{
+}
+
+OutputCapture::~OutputCapture()
+{
+    Stop();
+}
+
+bool OutputCapture::Start(OutputCallback callback)
+{
+    SetCurrentLoggingArea(LoggingArea::All);
+    if(m_running)
+        return true;
+
+    int fds[2];
+#ifdef _WIN32
+    if(_pipe(fds, PIPE_SIZE, _O_BINARY) != 0)
+#else
+    if(pipe(fds) != 0)
+#endif
+    {
+        Log("Failed to create pipe for stdout", LoggingPriority::Error);
+        return false;
+    }
+    m_read_fd = fds[0];
+    int write_fd = fds[1];
+
+    std::cout.flush();
+    fflush(stdout);
+    m_original_stdout = dup(STDOUT_FD);
+    if(m_original_stdout == -1 || dup2(write_fd, STDOUT_FD) == -1)
+    {
+        Log("Failed to redirect stdout", LoggingPriority::Error);
+        close(m_read_fd);
+        close(write_fd);
+        return false;
+    }
+#ifdef _WIN32
+    // The console is in text mode, so keep translating newlines for the readers of the
+    // output, and make sure that anything going through the Win32 handle ends up here too.
+    _setmode(STDOUT_FD, _O_TEXT);
+    SetStdHandle(STD_OUTPUT_HANDLE, reinterpret_cast<HANDLE>(_get_osfhandle(STDOUT_FD)));
+#endif
+    // stdout now holds the only reference to the write end we need
+    close(write_fd);
+
+    m_callback = std::move(callback);
+    m_running = true;
+    m_reader = std::thread(&OutputCapture::ReadLoop, this);
+    m_deliverer = std::thread(&OutputCapture::DeliveryLoop, this);
+    return true;
+}
+
+void OutputCapture::Stop()
+{
+    if(!m_running)
+        return;
+
+    Flush();
+    {
+        std::lock_guard<std::mutex> guard(m_signal_lock);
+        m_running = false;
+    }
+    m_data_available.notify_all();
+    m_space_available.notify_all();
+    m_reader.join();
+    m_deliverer.join();
+
+    // Restoring stdout closes the last write end of the pipe
+    dup2(m_original_stdout, STDOUT_FD);
+#ifdef _WIN32
+    SetStdHandle(STD_OUTPUT_HANDLE, reinterpret_cast<HANDLE>(_get_osfhandle(STDOUT_FD)));
+#endif
+    close(m_original_stdout);
+    close(m_read_fd);
+    m_original_stdout = -1;
+    m_read_fd = -1;
+}
+
+void OutputCapture::Flush()
+{
+    if(!m_running)
+        return;
+
+    std::cout.flush();
+    fflush(stdout);
+
+    std::unique_lock<std::mutex> signal_guard(m_signal_lock);
+    m_flush_requested = true;
+    signal_guard.unlock();
+    m_data_available.notify_all();
+
+    // Wait for the reader to drain the pipe...
+    for(;;)
+    {
+        {
+            std::lock_guard<std::mutex> read_guard(m_read_lock);
+            if(BytesAvailable() == 0)
+                break;
+        }
+        std::this_thread::yield();
+    }
+
+    // ...and for the delivery thread to hand everything the reader got to the callback
+    signal_guard.lock();
+    m_data_available.notify_all();
+    m_delivered.wait(signal_guard, [&]()
+                     {
+                         return !m_running || (m_ring.ReadableSize() == 0 && !m_delivering);
+                     });
+    m_flush_requested = false;
+}
+
+size_t OutputCapture::BytesAvailable()
+{
+#ifdef _WIN32
+    DWORD available = 0;
+    HANDLE pipe = reinterpret_cast<HANDLE>(_get_osfhandle(m_read_fd));
+    if(!PeekNamedPipe(pipe, nullptr, 0, nullptr, &available, nullptr))
+        return 0;
+    return available;
+#else
+    int available = 0;
+    if(ioctl(m_read_fd, FIONREAD, &available) != 0)
+        return 0;
+    return available;
+#endif
+}
+
+void OutputCapture::ReadLoop()
+{
+    while(m_running)
+    {
+#ifdef _WIN32
+        if(BytesAvailable() == 0)
+        {
+            Sleep(1);
+            continue;
+        }
+#else
+        pollfd poll_fd = { m_read_fd, POLLIN, 0 };
+        if(poll(&poll_fd, 1, POLL_INTERVAL_MS) <= 0)
+            continue;
+#endif
+        std::lock_guard<std::mutex> read_guard(m_read_lock);
+        size_t contiguous_size;
+        char *dest = m_ring.WritePointer(contiguous_size);
+        if(contiguous_size == 0)
+        {
+            // Leave the data in the pipe until the consumers catch up. This blocks
+            // the writer once the pipe fills up too.
+            std::unique_lock<std::mutex> signal_guard(m_signal_lock);
+            m_data_available.notify_all();
+            m_space_available.wait(signal_guard, [&]() { return !m_running || m_ring.WritableSize() > 0; });
+            continue;
+        }
+
+        int bytes_read = read(m_read_fd, dest, static_cast<unsigned>(std::min<size_t>(contiguous_size, MAX_READ_SIZE)));
+        if(bytes_read <= 0)
+            break;
+
+        m_ring.CommitWrite(static_cast<size_t>(bytes_read));
+        // Notifying under the lock after every read, rather than only when the buffer
+        // was empty before it, means the delivery thread can't check for data just before
+        // the commit and then miss the notification. Reads are large, so this is cheap.
+        std::lock_guard<std::mutex> signal_guard(m_signal_lock);
+        m_data_available.notify_all();
+    }
+}
+
+void OutputCapture::DeliveryLoop()
+{
+    std::unique_lock<std::mutex> signal_guard(m_signal_lock);
+    while(m_running)
+    {
+        m_data_available.wait(signal_guard, [&]() { return !m_running || m_ring.ReadableSize() > 0; });
+        if(!m_running)
+            break;
+
+        // Give the writer a moment to produce more before delivering, unless someone is
+        // waiting for the output or the buffer is filling up
+        m_data_available.wait_for(signal_guard, m_coalesce_interval, [&]()
+                                  {
+                                      return !m_running || m_flush_requested ||
+                                          m_ring.ReadableSize() >= m_ring.Capacity() / 2;
+                                  });
+
+        m_delivering = true;
+        signal_guard.unlock();
+        Deliver();
+        signal_guard.lock();
+        m_delivering = false;
+        m_space_available.notify_all();
+        m_delivered.notify_all();
+    }
+    m_delivered.notify_all();
+}
+
+void OutputCapture::Deliver()
+{
+    size_t remaining = m_ring.ReadableSize();
+    while(remaining > 0)
+    {
+        size_t contiguous_size;
+        const char *data = m_ring.ReadPointer(contiguous_size);
+        size_t chunk = std::min(contiguous_size, remaining);
+        m_callback(data, chunk);
+        m_ring.CommitRead(chunk);
+        remaining -= chunk;
+    }
+}
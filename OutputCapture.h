@@ -0,0 +1,77 @@
+#ifndef OUTPUT_CAPTURE_H
+#define OUTPUT_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "RingBuffer.h"
+
+// Redirects the process's stdout into a pipe and hands everything written to it to a
+// callback. This is how the playground shows the output of JIT'd code, which writes
+// straight to the C runtime's stdout.
+//
+// A reader thread drains the pipe with large reads straight into a bounded ring buffer.
+// A delivery thread coalesces whatever arrived during an interval and passes it to the
+// callback in place, so consumers see a few large appends rather than one per write.
+// When consumers fall behind, the ring buffer fills up, the reader stops draining the
+// pipe and the writing code blocks until they catch up.
+class OutputCapture
+{
+public:
+    // data is only valid for the duration of the call. Deltas are delivered in order
+    // and only ever append to what was delivered before.
+    using OutputCallback = std::function<void(const char *data, size_t size)>;
+
+    static constexpr size_t DefaultBufferSize = 1 << 20;
+    static constexpr std::chrono::milliseconds DefaultCoalesceInterval{ 16 };
+
+    OutputCapture(size_t buffer_size = DefaultBufferSize,
+                  std::chrono::milliseconds coalesce_interval = DefaultCoalesceInterval);
+    ~OutputCapture();
+    OutputCapture(const OutputCapture &) = delete;
+    OutputCapture &operator=(const OutputCapture &) = delete;
+
+    // Returns false if stdout could not be redirected
+    bool Start(OutputCallback callback);
+    void Stop();
+    // Blocks until everything written to stdout so far has been handed to the callback
+    void Flush();
+    // A descriptor for the stdout the process had before Start(), or -1 if not started
+    int GetOriginalStdout() const { return m_original_stdout; }
+
+private:
+    void ReadLoop();
+    void DeliveryLoop();
+    void Deliver();
+    size_t BytesAvailable();
+
+    OutputCallback m_callback;
+    int m_read_fd = -1;
+    int m_original_stdout = -1;
+    std::atomic<bool> m_running{ false };
+
+    RingBuffer m_ring;
+    const std::chrono::milliseconds m_coalesce_interval;
+
+    // Held while reading from the pipe, so that Flush() can tell when the pipe has been drained
+    std::mutex m_read_lock;
+    // Protects the flags below and is used with the condition variables to signal
+    // between the reader, the delivery thread and Flush(). The data itself goes
+    // through the lock-free ring buffer.
+    std::mutex m_signal_lock;
+    std::condition_variable m_data_available;
+    std::condition_variable m_space_available;
+    std::condition_variable m_delivered;
+    bool m_flush_requested = false;
+    bool m_delivering = false;
+
+    std::thread m_reader;
+    std::thread m_deliverer;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "PlaygroundEngine.h"
+#include "Logging.h"
+#include "Strings.h"
+
+#include <algorithm>
+#include <cctype>
+
+PlaygroundEngine::PlaygroundEngine(CommandLineOptions opts)
+    : m_opts(std::move(opts)),
+      m_min_line(0),
+      m_executed_end(0)
+{
+    m_opts.is_playground = true;
+}
+
+PlaygroundEngine::~PlaygroundEngine()
+{
+    if(m_opts.playground_logging)
+        PlaygroundLog::Get().Stop();
+}
+
+bool PlaygroundEngine::Start(Callbacks callbacks)
+{
+    m_callbacks = std::move(callbacks);
+    if(m_opts.playground_logging)
+    {
+        PlaygroundLog::Get().Start([this]()
+                                   {
+                                       if(m_callbacks.on_log_updated)
+                                           m_callbacks.on_log_updated();
+                                   });
+    }
+    if(m_callbacks.on_diagnostics)
+    {
+        m_checker.Start([this]() { return CreateREPL(); },
+                        [this]()
+                        {
+                            std::lock_guard<std::mutex> guard(m_document_lock);
+                            return m_document.GetText();
+                        },
+                        m_callbacks.on_diagnostics);
+    }
+    return m_capture.Start([this](const char *data, size_t size)
+                           {
+                               if(m_callbacks.on_output)
+                                   m_callbacks.on_output(data, size);
+                           });
+}
+
+std::unique_ptr<REPL> PlaygroundEngine::CreateREPL()
+{
+    llvm::Expected<std::unique_ptr<REPL>> repl = REPL::Create(m_opts.is_playground, m_opts.default_module_cache_path);
+    if(!repl)
+    {
+        std::string err_str;
+        llvm::raw_string_ostream stream(err_str);
+        stream << repl.takeError();
+        stream.flush();
+        SetCurrentLoggingArea(LoggingArea::All);
+        Log(err_str, LoggingPriority::Error);
+        return nullptr;
+    }
+
+    (*repl)->SetOptimizationsEnabled(m_opts.optimize);
+    std::for_each(m_opts.include_paths.begin(), m_opts.include_paths.end(),
+                  [&](auto s) { (*repl)->AddModuleSearchPath(s); });
+    std::for_each(m_opts.link_paths.begin(), m_opts.link_paths.end(),
+                  [&](auto s) { (*repl)->AddLoadSearchPath(s); });
+    if(m_opts.playground_logging)
+        (*repl)->EnablePlaygroundLogging();
+    return std::move(*repl);
+}
+
+// Prefer the background checker's REPL, which has already loaded the standard
+// library and the document's imports.
+void PlaygroundEngine::ResetREPL()
+{
+    m_repl = m_checker.TakeREPL();
+    if(!m_repl)
+        m_repl = CreateREPL();
+}
+
+// The executed code ends in the middle of a line unless everything after it on
+// that line is whitespace, in which case typing there starts a new statement.
+bool PlaygroundEngine::IsLastExecutedLineIntact() const
+{
+    for(size_t offset = m_executed_end; offset < m_document.Size(); offset++)
+    {
+        char c = m_document.CharAt(offset);
+        if(c == '\n')
+            return true;
+        if(!std::isspace(static_cast<unsigned char>(c)))
+            return false;
+    }
+    return true;
+}
+
+void PlaygroundEngine::ApplyEdit(size_t offset, size_t removed_length, const std::string &inserted)
+{
+    offset = std::min(offset, m_document.Size());
+    {
+        std::lock_guard<std::mutex> guard(m_document_lock);
+        m_document.Replace(offset, removed_length, inserted);
+    }
+    m_checker.NotifyEdit();
+    if(m_min_line != 0 && (offset < m_executed_end || !IsLastExecutedLineIntact()))
+        m_min_line = 0;
+}
+
+void PlaygroundEngine::SetText(const std::string &text)
+{
+    std::string curr_text = m_document.GetText();
+    size_t prefix = std::mismatch(curr_text.begin(), curr_text.end(), text.begin(), text.end()).first - curr_text.begin();
+    size_t max_suffix = std::min(curr_text.size(), text.size()) - prefix;
+    size_t suffix = std::mismatch(curr_text.rbegin(), curr_text.rbegin() + max_suffix, text.rbegin()).first - curr_text.rbegin();
+    ApplyEdit(prefix, curr_text.size() - prefix - suffix, text.substr(prefix, text.size() - prefix - suffix));
+}
+
+void PlaygroundEngine::ExecuteFrom(size_t offset)
+{
+    std::string to_execute = m_document.GetText(offset, m_document.Size() - offset);
+    size_t last = to_execute.find_last_not_of(" \t\r\n\v\f");
+    if(last == std::string::npos)
+        return;
+
+    m_executed_end = offset + last + 1;
+    m_min_line = static_cast<int>(m_document.LineOfOffset(m_executed_end - 1)) + 1;
+    if(m_opts.playground_logging)
+    {
+        size_t first = offset + to_execute.find_first_not_of(" \t\r\n\v\f");
+        size_t first_line = m_document.LineOfOffset(first);
+        PlaygroundLog::Get().SetSourceOrigin(static_cast<int>(first_line),
+                                             static_cast<int>(first - m_document.LineStart(first_line)));
+    }
+    Trim(to_execute);
+    to_execute.erase(std::remove(to_execute.begin(), to_execute.end(), '\r'), to_execute.end()); // Effectively changes \r\n to \n
+    m_repl->ExecuteSwift(to_execute);
+}
+
+void PlaygroundEngine::RecompileEverything()
+{
+    ResetREPL();
+    if(!m_repl)
+        return;
+
+    FlushOutput();
+    if(m_callbacks.on_clear_output)
+        m_callbacks.on_clear_output();
+    if(m_opts.playground_logging)
+        PlaygroundLog::Get().Clear();
+    m_executed_end = 0;
+    m_min_line = 1;
+    ExecuteFrom(0);
+}
+
+void PlaygroundEngine::ContinueExecution()
+{
+    if(m_min_line == 0 || !m_repl)
+        return RecompileEverything();
+    ExecuteFrom(m_executed_end);
+}
+
+void PlaygroundEngine::FlushOutput()
+{
+    m_capture.Flush();
+}
+
+std::vector<PlaygroundLogEntry> PlaygroundEngine::GetLogEntries()
+{
+    PlaygroundLog::Get().Drain();
+    return PlaygroundLog::Get().GetEntries();
+}
+
+void PlaygroundEngine::WaitForCheck()
+{
+    m_checker.WaitForIdle();
+}
@@ -0,0 +1,89 @@
+#ifndef PLAYGROUND_ENGINE_H
+#define PLAYGROUND_ENGINE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "BackgroundChecker.h"
+#include "CommandLineOptions.h"
+#include "Document.h"
+#include "OutputCapture.h"
+#include "PlaygroundLog.h"
+#include "REPL.h"
+
+// The platform independent part of the playground: it owns the document, the REPL
+// and the output capture, and decides how much of the document needs to be executed.
+// UIs (the Win32 window, the headless protocol driver) feed it text and show its output.
+class PlaygroundEngine
+{
+public:
+    struct Callbacks
+    {
+        // Called on the output capture thread with everything the playground prints
+        std::function<void(const char *data, size_t size)> on_output;
+        // Called before the whole document is re-executed
+        std::function<void()> on_clear_output;
+        // If set, the document is type-checked in the background while it's being
+        // edited. Called on the checking thread with the diagnostics for the latest text.
+        std::function<void(const std::vector<REPL::Diagnostic> &)> on_diagnostics;
+        // Called on the log's drain thread when values or execution counts have changed.
+        // Only used with --playground_logging=true.
+        std::function<void()> on_log_updated;
+    };
+
+    explicit PlaygroundEngine(CommandLineOptions opts);
+    ~PlaygroundEngine();
+    // Returns false if the output capture could not be started
+    bool Start(Callbacks callbacks);
+
+    // Replaces removed_length characters at offset with inserted. Edits are
+    // applied to the document in place, so typing costs O(edit size + log(document)).
+    void ApplyEdit(size_t offset, size_t removed_length, const std::string &inserted);
+    // Replaces the whole document, for UIs that can't tell what changed. This
+    // diffs against the current document, so it's O(document).
+    void SetText(const std::string &text);
+    void RecompileEverything();
+    // Executes the lines after the last executed line, or everything if the
+    // already executed lines have changed.
+    void ContinueExecution();
+    // Blocks until all output of the executed code has been passed to on_output
+    void FlushOutput();
+    // Values and execution counts logged since the last recompile, up to now
+    std::vector<PlaygroundLogEntry> GetLogEntries();
+    // Blocks until the background check of the current text has been published
+    void WaitForCheck();
+
+    // The line execution will continue from, or 0 if everything must be recompiled
+    int GetMinLine() const { return m_min_line; }
+    // Number of lines in the document as typed, for line numbering
+    int GetRawLineCount() const { return static_cast<int>(m_document.LineCount()); }
+    const Document &GetDocument() const { return m_document; }
+    int GetOriginalStdout() const { return m_capture.GetOriginalStdout(); }
+
+private:
+    std::unique_ptr<REPL> CreateREPL();
+    void ResetREPL();
+    bool IsLastExecutedLineIntact() const;
+    void ExecuteFrom(size_t offset);
+
+    CommandLineOptions m_opts;
+    Callbacks m_callbacks;
+    OutputCapture m_capture;
+    std::unique_ptr<REPL> m_repl;
+
+    // Edits happen on the UI thread, which is also the only other reader of the
+    // document, so the lock is only needed for edits and the checking thread's reads.
+    std::mutex m_document_lock;
+    Document m_document;
+    int m_min_line;
+    // Offset just past the last non-whitespace character that has been executed
+    size_t m_executed_end;
+
+    // Last so that it's stopped before anything it uses is destroyed
+    BackgroundChecker m_checker;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include "PlaygroundLog.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+// The prelude declares the host functions with @_silgen_name, so they are called
+// with the Swift calling convention
+#if defined(__has_attribute)
+#if __has_attribute(swiftcall)
+#define SWIFT_CC __attribute__((swiftcall))
+#endif
+#endif
+#ifndef SWIFT_CC
+#define SWIFT_CC
+#endif
+
+static constexpr size_t THREAD_BUFFER_SIZE = 1 << 20;
+static constexpr size_t MAX_VALUE_TEXT_SIZE = 1024;
+// Values of a line are described for its first few executions and then at every power of two
+static constexpr uint64_t ALWAYS_DESCRIBED_COUNT = 8;
+
+// Bumped by Clear() so that every thread starts counting executions from scratch
+static std::atomic<uint64_t> s_describe_epoch{ 0 };
+
+extern "C" SWIFT_CC void swift_repl_playground_log(intptr_t kind,
+                                                   intptr_t start_line, intptr_t end_line,
+                                                   intptr_t start_column, intptr_t end_column,
+                                                   const char *text, intptr_t text_size)
+{
+    PlaygroundLog::Get().Append(static_cast<PlaygroundLogKind>(kind),
+                                static_cast<int>(start_line), static_cast<int>(end_line),
+                                static_cast<int>(start_column), static_cast<int>(end_column),
+                                text, static_cast<size_t>(text_size));
+}
+
+extern "C" SWIFT_CC intptr_t swift_repl_playground_should_describe(intptr_t start_line, intptr_t start_column)
+{
+    thread_local std::unordered_map<uint64_t, uint64_t> t_counts;
+    thread_local uint64_t t_epoch = 0;
+    uint64_t epoch = s_describe_epoch.load(std::memory_order_relaxed);
+    if(t_epoch != epoch)
+    {
+        t_counts.clear();
+        t_epoch = epoch;
+    }
+    uint64_t key = (static_cast<uint64_t>(start_line) << 32) | static_cast<uint32_t>(start_column);
+    uint64_t count = ++t_counts[key];
+    return count <= ALWAYS_DESCRIBED_COUNT || (count & (count - 1)) == 0;
+}
+
+const char *PlaygroundLog::GetPrelude()
+{
+    // Both the current argument lists (with module and file IDs) and the older ones
+    // without them are provided, the transform picks whichever it generates.
+    return R"(
+@_silgen_name("swift_repl_playground_log")
+func __repl_playground_log(_ kind: Int, _ sl: Int, _ el: Int, _ sc: Int, _ ec: Int, _ text: UnsafePointer<CChar>?, _ text_size: Int)
+@_silgen_name("swift_repl_playground_should_describe")
+func __repl_playground_should_describe(_ sl: Int, _ sc: Int) -> Int
+
+func __builtin_log_with_id<T>(_ object: T, _ name: String, _ id: Int, _ sl: Int, _ el: Int, _ sc: Int, _ ec: Int, _ moduleID: Int, _ fileID: Int) -> AnyObject? {
+    if name.hasPrefix("__repl_") { return nil }
+    if __repl_playground_should_describe(sl, sc) != 0 {
+        String(describing: object).utf8CString.withUnsafeBufferPointer {
+            __repl_playground_log(0, sl, el, sc, ec, $0.baseAddress, $0.count - 1)
+        }
+    } else {
+        __repl_playground_log(0, sl, el, sc, ec, nil, 0)
+    }
+    return nil
+}
+func __builtin_log_with_id<T>(_ object: T, _ name: String, _ id: Int, _ sl: Int, _ el: Int, _ sc: Int, _ ec: Int) -> AnyObject? {
+    return __builtin_log_with_id(object, name, id, sl, el, sc, ec, 0, 0)
+}
+func __builtin_log_scope_entry(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int, _ moduleID: Int, _ fileID: Int) -> AnyObject? {
+    __repl_playground_log(1, sl, el, sc, ec, nil, 0)
+    return nil
+}
+func __builtin_log_scope_entry(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int) -> AnyObject? {
+    return __builtin_log_scope_entry(sl, el, sc, ec, 0, 0)
+}
+func __builtin_log_scope_exit(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int, _ moduleID: Int, _ fileID: Int) -> AnyObject? { return nil }
+func __builtin_log_scope_exit(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int) -> AnyObject? { return nil }
+func __builtin_postPrint(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int, _ moduleID: Int, _ fileID: Int) -> AnyObject? { return nil }
+func __builtin_postPrint(_ sl: Int, _ el: Int, _ sc: Int, _ ec: Int) -> AnyObject? { return nil }
+func __builtin_send_data(_ object: AnyObject?) {}
+)";
+}
+
+std::vector<std::pair<const char *, void *>> PlaygroundLog::GetHostFunctions()
+{
+    return {
+        { "swift_repl_playground_log", reinterpret_cast<void *>(&swift_repl_playground_log) },
+        { "swift_repl_playground_should_describe", reinterpret_cast<void *>(&swift_repl_playground_should_describe) },
+    };
+}
+
+PlaygroundLog &PlaygroundLog::Get()
+{
+    static PlaygroundLog s_log;
+    return s_log;
+}
+
+RingBuffer &PlaygroundLog::GetThreadBuffer()
+{
+    thread_local RingBuffer *t_buffer = nullptr;
+    if(!t_buffer)
+    {
+        std::lock_guard<std::mutex> guard(m_buffers_lock);
+        m_buffers.push_back(std::make_unique<RingBuffer>(THREAD_BUFFER_SIZE));
+        t_buffer = m_buffers.back().get();
+    }
+    return *t_buffer;
+}
+
+void PlaygroundLog::SetSourceOrigin(int line, int column)
+{
+    m_origin_line = line;
+    m_origin_column = column;
+}
+
+void PlaygroundLog::Append(PlaygroundLogKind kind, int start_line, int end_line, int start_column, int end_column,
+                           const char *text, size_t text_size)
+{
+    // Only the first line of the input is shifted horizontally
+    int origin_column = m_origin_column.load(std::memory_order_relaxed);
+    if(start_line == 1)
+        start_column += origin_column;
+    if(end_line == 1)
+        end_column += origin_column;
+    int origin_line = m_origin_line.load(std::memory_order_relaxed);
+    start_line += origin_line;
+    end_line += origin_line;
+
+    RecordHeader header;
+    header.kind = kind;
+    header.text_size = static_cast<uint32_t>(text ? std::min(text_size, MAX_VALUE_TEXT_SIZE) : 0);
+    header.start_line = start_line;
+    header.end_line = end_line;
+    header.start_column = start_column;
+    header.end_column = end_column;
+
+    // The records of one thread are only ever written by that thread, so checking for
+    // space up front means the header and text go in together. When the buffer is full,
+    // drain it here rather than wait for the drain thread, which may not get to run soon.
+    RingBuffer &buffer = GetThreadBuffer();
+    size_t record_size = sizeof(header) + header.text_size;
+    while(buffer.WritableSize() < record_size)
+    {
+        std::unique_lock<std::mutex> lock(m_entries_lock, std::try_to_lock);
+        if(lock.owns_lock())
+            DrainLocked();
+        else
+            std::this_thread::yield();
+    }
+    buffer.Write(&header, sizeof(header));
+    if(header.text_size)
+        buffer.Write(text, header.text_size);
+}
+
+bool PlaygroundLog::DrainLocked()
+{
+    std::vector<RingBuffer *> buffers;
+    {
+        std::lock_guard<std::mutex> guard(m_buffers_lock);
+        for(const std::unique_ptr<RingBuffer> &buffer : m_buffers)
+            buffers.push_back(buffer.get());
+    }
+
+    bool changed = false;
+    std::string text;
+    for(RingBuffer *buffer : buffers)
+    {
+        // Loops log the same few lines over and over, so remember the last entry
+        RecordHeader header;
+        RecordHeader last_header = {};
+        PlaygroundLogEntry *last_entry = nullptr;
+        // A record is complete once all of it is readable
+        while(buffer->Peek(&header, sizeof(header)) &&
+              buffer->ReadableSize() >= sizeof(header) + header.text_size)
+        {
+            buffer->CommitRead(sizeof(header));
+            text.resize(header.text_size);
+            if(header.text_size)
+                buffer->Read(&text[0], header.text_size);
+
+            PlaygroundLogEntry *entry = last_entry;
+            if(!entry ||
+               header.kind != last_header.kind ||
+               header.start_line != last_header.start_line ||
+               header.start_column != last_header.start_column ||
+               header.end_line != last_header.end_line ||
+               header.end_column != last_header.end_column)
+            {
+                EntryKey key(header.start_line, header.start_column, header.end_line, header.end_column, header.kind);
+                auto inserted = m_entries.emplace(key, PlaygroundLogEntry{ header.kind,
+                                                                           header.start_line, header.end_line,
+                                                                           header.start_column, header.end_column,
+                                                                           0, "", 0 });
+                entry = &inserted.first->second;
+                last_entry = entry;
+                last_header = header;
+            }
+            entry->count++;
+            if(header.text_size)
+            {
+                entry->value = text;
+                entry->value_count = entry->count;
+            }
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void PlaygroundLog::Drain()
+{
+    bool changed;
+    {
+        std::lock_guard<std::mutex> guard(m_entries_lock);
+        changed = DrainLocked();
+    }
+    if(changed && m_on_update)
+        m_on_update();
+}
+
+void PlaygroundLog::Clear()
+{
+    std::lock_guard<std::mutex> guard(m_entries_lock);
+    DrainLocked();
+    m_entries.clear();
+    s_describe_epoch++;
+}
+
+std::vector<PlaygroundLogEntry> PlaygroundLog::GetEntries()
+{
+    std::lock_guard<std::mutex> guard(m_entries_lock);
+    std::vector<PlaygroundLogEntry> result;
+    result.reserve(m_entries.size());
+    for(const auto &entry : m_entries)
+        result.push_back(entry.second);
+    return result;
+}
+
+void PlaygroundLog::Start(std::function<void()> on_update, std::chrono::milliseconds drain_interval)
+{
+    if(m_running)
+        return;
+    m_on_update = std::move(on_update);
+    m_running = true;
+    m_drainer = std::thread(&PlaygroundLog::DrainLoop, this, drain_interval);
+}
+
+void PlaygroundLog::Stop()
+{
+    if(!m_running)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(m_stop_lock);
+        m_running = false;
+    }
+    m_stop_requested.notify_all();
+    m_drainer.join();
+    Drain();
+}
+
+void PlaygroundLog::DrainLoop(std::chrono::milliseconds drain_interval)
+{
+    std::unique_lock<std::mutex> lock(m_stop_lock);
+    while(m_running)
+    {
+        lock.unlock();
+        Drain();
+        lock.lock();
+        m_stop_requested.wait_for(lock, drain_interval, [&]() { return !m_running; });
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef PLAYGROUND_LOG_H
+#define PLAYGROUND_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "RingBuffer.h"
+
+// Per-line value and execution count logging for the playground.
+//
+// With playground logging enabled, the REPL runs Swift's playground transform, which
+// calls __builtin_log_with_id after every statement that produces a value and
+// __builtin_log_scope_entry at the start of every function and loop body. Those are
+// defined by a Swift prelude (GetPrelude) that calls back into the host.
+//
+// The host side appends a small binary record to a ring buffer that belongs to the
+// calling thread, so logging never takes a lock or allocates. Turning a value into
+// text is the expensive part, so it is only done for the first few executions of a
+// line and then at every power of two; every execution is still counted. A drain
+// thread folds the records into one entry per source range and tells the UI. A thread
+// that fills its buffer folds its own records instead of waiting.
+enum class PlaygroundLogKind : uint32_t
+{
+    Value,
+    ScopeEntry,
+};
+
+struct PlaygroundLogEntry
+{
+    PlaygroundLogKind kind;
+    int start_line;
+    int end_line;
+    int start_column;
+    int end_column;
+    // Number of times the line was executed
+    uint64_t count;
+    // The most recently described value, and which execution it came from
+    std::string value;
+    uint64_t value_count;
+};
+
+class PlaygroundLog
+{
+public:
+    static PlaygroundLog &Get();
+
+    // on_update is called on the drain thread whenever entries have changed
+    void Start(std::function<void()> on_update,
+               std::chrono::milliseconds drain_interval = std::chrono::milliseconds(16));
+    void Stop();
+    // Folds everything logged so far into the entries
+    void Drain();
+    void Clear();
+    // Sorted by position
+    std::vector<PlaygroundLogEntry> GetEntries();
+
+    // Swift code that defines the functions the playground transform calls
+    static const char *GetPrelude();
+    // Host functions called by the prelude, to be defined in the JIT
+    static std::vector<std::pair<const char *, void *>> GetHostFunctions();
+
+    // Locations in the transformed code are relative to the input that was executed,
+    // which starts at 0-based line and column in the document.
+    void SetSourceOrigin(int line, int column);
+
+    // Called from JIT'd code
+    void Append(PlaygroundLogKind kind, int start_line, int end_line, int start_column, int end_column,
+                const char *text, size_t text_size);
+
+private:
+    struct RecordHeader
+    {
+        PlaygroundLogKind kind;
+        uint32_t text_size;
+        int32_t start_line;
+        int32_t end_line;
+        int32_t start_column;
+        int32_t end_column;
+    };
+    using EntryKey = std::tuple<int, int, int, int, PlaygroundLogKind>;
+
+    PlaygroundLog() = default;
+    RingBuffer &GetThreadBuffer();
+    bool DrainLocked();
+    void DrainLoop(std::chrono::milliseconds drain_interval);
+
+    // Every thread that logs gets a buffer. They are never freed, since a thread can
+    // exit at any time and the records it left behind still need to be drained.
+    std::mutex m_buffers_lock;
+    std::vector<std::unique_ptr<RingBuffer>> m_buffers;
+
+    // Protects m_entries and serializes draining
+    std::mutex m_entries_lock;
+    std::map<EntryKey, PlaygroundLogEntry> m_entries;
+
+    std::atomic<int> m_origin_line{ 0 };
+    std::atomic<int> m_origin_column{ 0 };
+
+    std::function<void()> m_on_update;
+    std::atomic<bool> m_running{ false };
+    std::mutex m_stop_lock;
+    std::condition_variable m_stop_requested;
+    std::thread m_drainer;
+};
+
+#endif
@@ -1,18 +1,39 @@
 #include "REPL.h"
+#include "CCompiler.h"
 #include "Logging.h"
 #include "TransformAST.h"
 #include "TransformIR.h"
 #include "Config.h"
+#include "PlaygroundLog.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <mutex>
+#include <set>
 #include <string>
 #include <tuple>
 #include <type_traits>
+#include <unordered_set>
 
 #include <swift/AST/ASTMangler.h>
+#include <swift/AST/ASTWalker.h>
+#include <swift/AST/DiagnosticsFrontend.h>
+#include <swift/AST/DiagnosticsSIL.h>
+#include <swift/AST/TypeRepr.h>
+#include <swift/AST/Types.h>
+#include <swift/Parse/Lexer.h>
+#include <swift/Serialization/SerializationOptions.h>
 #include <swift/SILOptimizer/PassManager/Passes.h>
 
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SourceMgr.h>
+
 void ConfigureFunctionLinkage(swift::SourceFile &src_file, std::unique_ptr<swift::SILModule> &sil_module)
 {
     SetCurrentLoggingArea(LoggingArea::SIL);
@@ -27,7 +48,12 @@ void ConfigureFunctionLinkage(swift::SourceFile &src_file, std::unique_ptr<swift
             std::string name_original = fn->getName().str();
             std::string name_mangled = sil_decl.mangle();
 
-            sil_module->lookUpFunction(sil_decl)->setLinkage(swift::SILLinkage::Public);
+            // Functions without a body, like @_silgen_name declarations of functions
+            // defined in SIL blocks, only exist if this input calls them
+            swift::SILFunction *sil_fn = sil_module->lookUpFunction(sil_decl);
+            if(!sil_fn)
+                continue;
+            sil_fn->setLinkage(swift::SILLinkage::Public);
             Log(std::string("Set function ") + name_original + " (" + name_mangled + ") to public");
         }
     }
@@ -60,6 +86,53 @@ void REPL::RemoveRedeclarationsFromJIT(std::unique_ptr<llvm::Module> &llvm_modul
     }
 }
 
+void REPL::PrinterDiagnosticConsumer::handleDiagnostic(swift::SourceManager &src_mgr,
+                                                       swift::SourceLoc loc,
+                                                       swift::DiagnosticKind kind,
+                                                       llvm::StringRef fmt_str,
+                                                       llvm::ArrayRef<swift::DiagnosticArgument> fmt_args,
+                                                       const swift::DiagnosticInfo &info,
+                                                       const swift::SourceLoc)
+{
+    //NOTE(sasha): We don't use normal logging system here because we always
+    //             want to show compiler errors.
+    std::string diagnostic;
+    llvm::raw_string_ostream stream(diagnostic);
+    swift::DiagnosticEngine::formatDiagnosticText(stream, fmt_str, fmt_args);
+    stream.flush();
+
+    if(kind == swift::DiagnosticKind::Remark && m_remarks)
+    {
+        Remark remark;
+        remark.kind = info.ID == swift::diag::opt_remark_missed.ID ? RemarkKind::Missed :
+                                                                    RemarkKind::Passed;
+        remark.origin = "SIL";
+        remark.message = diagnostic;
+        if(loc.isValid())
+        {
+            unsigned buffer_id = src_mgr.findBufferContainingLoc(loc);
+            std::tie(remark.line, remark.column) = src_mgr.getLineAndColumn(loc, buffer_id);
+            remark.buffer_name = src_mgr.getIdentifierForBuffer(buffer_id).str();
+        }
+        m_remarks->push_back(std::move(remark));
+        return;
+    }
+    if(m_handler)
+    {
+        Diagnostic result;
+        result.kind = kind;
+        result.message = diagnostic;
+        if(loc.isValid())
+        {
+            unsigned buffer_id = src_mgr.findBufferContainingLoc(loc);
+            std::tie(result.line, result.column) = src_mgr.getLineAndColumn(loc, buffer_id);
+        }
+        m_handler(result);
+        return;
+    }
+    std::cout << diagnostic << std::endl;
+}
+
 llvm::Expected<std::unique_ptr<REPL>> REPL::Create(
     bool is_playground,
     std::string default_module_cache_path)
@@ -80,16 +153,15 @@ REPL::REPL(bool is_playground, std::string default_module_cache_path)
     : m_is_playground(is_playground),
       m_default_module_cache_path(default_module_cache_path),
       m_curr_input_number(1),
+      m_optimize(false),
+      m_playground_logging(false),
       m_diagnostic_engine(m_src_mgr),
       m_ast_ctx(swift::ASTContext::get(m_lang_opts, m_spath_opts, m_src_mgr,
                                        m_diagnostic_engine))
 {
-    static bool s_run_guard = false;
-    if(!s_run_guard)
-    {
-        INITIALIZE_LLVM();
-        s_run_guard = true;
-    }
+    // The playground creates REPLs on its type-checking thread as well
+    static std::once_flag s_llvm_initialized;
+    std::call_once(s_llvm_initialized, []() { INITIALIZE_LLVM(); });
 
     m_diagnostic_engine.setShowDiagnosticsAfterFatalError();
     m_diagnostic_engine.addConsumer(m_diagnostic_consumer);
@@ -102,16 +174,88 @@ REPL::REPL(bool is_playground, std::string default_module_cache_path)
     swift::registerTypeCheckerRequestFunctions(m_ast_ctx->evaluator);
 }
 
-std::string REPL::GetLine()
+REPL::~REPL()
+{
+    if(!m_c_dir.empty())
+        llvm::sys::fs::remove_directories(m_c_dir);
+}
+
+// Only a guess from the keywords a line starts with, to decide whether to keep
+// reading. ModifyCoalescedAST checks what the lines actually declare.
+static bool IsFunctionOrTypeDeclaration(llvm::StringRef line)
+{
+    llvm::SmallVector<llvm::StringRef, 4> words;
+    line.split(words, ' ', -1, false);
+    for(llvm::StringRef word : words)
+    {
+        // Attributes and modifiers can come before the keyword
+        if(word.startswith("@"))
+            continue;
+        bool is_modifier = llvm::StringSwitch<bool>(word)
+            .Cases("public", "private", "fileprivate", "internal", "open", true)
+            .Cases("final", "indirect", "prefix", "postfix", "infix", true)
+            .Default(false);
+        if(is_modifier)
+            continue;
+        return llvm::StringSwitch<bool>(word)
+            .Cases("func", "struct", "class", "enum", "protocol", true)
+            .Case("typealias", true)
+            .Default(false);
+    }
+    return false;
+}
+
+std::vector<std::string> REPL::GetLines(bool coalesce)
 {
+    // Lines that arrive within this long of each other are considered part of the same paste
+    constexpr std::chrono::milliseconds coalesce_window(5);
+
     std::cout << "\n";
-    std::string result = "";
-    do
+    std::vector<std::string> lines;
+    for(const std::string &pending : m_pending_lines)
     {
         std::cout << m_curr_input_number << "> ";
-        std::getline(std::cin, result);
-    } while(result.empty());
-    return result;
+        if(!pending.empty())
+            lines.push_back(pending);
+    }
+    m_pending_lines.clear();
+
+    while(lines.empty())
+    {
+        std::cout << m_curr_input_number << "> ";
+        std::cout.flush();
+        std::string line;
+        if(!m_line_reader.ReadLine(line))
+            return { "exit" };
+        if(!line.empty())
+            lines.push_back(line);
+    }
+
+    if(!coalesce || m_raw_block || IsCommand(lines.front()))
+        return lines;
+
+    std::vector<std::string> blank_lines;
+    std::string line;
+    while(IsFunctionOrTypeDeclaration(lines.back()) &&
+          m_line_reader.HasLine(coalesce_window) &&
+          m_line_reader.ReadLine(line))
+    {
+        if(line.empty())
+        {
+            blank_lines.push_back(line);
+            continue;
+        }
+        if(IsCommand(line) || IsExitString(line))
+        {
+            blank_lines.push_back(line);
+            break;
+        }
+        lines.insert(lines.end(), blank_lines.begin(), blank_lines.end());
+        blank_lines.clear();
+        lines.push_back(line);
+    }
+    m_pending_lines = std::move(blank_lines);
+    return lines;
 }
 
 void REPL::AddModuleSearchPath(std::string path)
@@ -124,93 +268,282 @@ void REPL::AddLoadSearchPath(std::string path)
     m_jit->AddSearchPath(path);
 }
 
-bool REPL::IsExitString(const std::string &line)
+void REPL::SetOptimizationsEnabled(bool optimize)
+{
+    m_optimize = optimize;
+    SetupLangOpts();
+    SetupSILOpts();
+    SetupIROpts();
+}
+
+bool REPL::EnablePlaygroundLogging()
+{
+    if(m_playground_logging)
+        return true;
+    for(const auto &function : PlaygroundLog::GetHostFunctions())
+        m_jit->AddAbsoluteSymbol(function.first, function.second);
+    if(!ExecuteSwift(PlaygroundLog::GetPrelude()) || LastInputHadError())
+    {
+        SetCurrentLoggingArea(LoggingArea::AST);
+        Log("Failed to declare the playground logging functions", LoggingPriority::Error);
+        return false;
+    }
+    m_playground_logging = true;
+    return true;
+}
+
+bool REPL::IsExitString(llvm::StringRef line)
 {
     return line == "e" || line == "exit";
 }
 
+bool REPL::LastInputHadError()
+{
+    return m_diagnostic_engine.hadAnyError() || m_input_rejected;
+}
+
+bool REPL::IsCommand(llvm::StringRef line)
+{
+    return !line.empty() && line[0] == ':';
+}
+
 // NOTE(sasha): We don't use the normal logging system here because the
 //              DiagnosticEngine will have shown the error.
 // TODO(sasha): Make this not print to stdout
 #define CHECK_ERROR() if(m_diagnostic_engine.hadAnyError()) { return true; }
-#define PRINT_INVALID_REDECLARATION(name) { std::cout << "Invalid redeclaration of " << name << "\n"; return true; }
 
-bool REPL::ExecuteSwift(std::string line)
+// Maps the types ResultValue can read to how they are laid out
+static ResultType GetResultType(swift::Type type)
+{
+    ResultType result;
+    result.kind = ResultKind::Unsupported;
+    swift::NominalTypeDecl *nominal = type->getAnyNominal();
+    if(!nominal || !nominal->getModuleContext()->isStdlibModule())
+        return result;
+
+    if(auto *bound_generic = type->getAs<swift::BoundGenericStructType>())
+    {
+        if(nominal->getName().str() != "Array")
+            return result;
+        ResultType element = GetResultType(bound_generic->getGenericArgs()[0]);
+        if(element.kind == ResultKind::Array || element.kind == ResultKind::Unsupported)
+            return result;
+        result.kind = ResultKind::Array;
+        result.element_kind = element.kind;
+        result.element_bit_width = element.bit_width;
+        return result;
+    }
+
+    std::tie(result.kind, result.bit_width) =
+        llvm::StringSwitch<std::pair<ResultKind, unsigned>>(nominal->getName().str())
+        .Case("Int", { ResultKind::Int, 64 })
+        .Case("Int8", { ResultKind::Int, 8 })
+        .Case("Int16", { ResultKind::Int, 16 })
+        .Case("Int32", { ResultKind::Int, 32 })
+        .Case("Int64", { ResultKind::Int, 64 })
+        .Case("UInt", { ResultKind::UInt, 64 })
+        .Case("UInt8", { ResultKind::UInt, 8 })
+        .Case("UInt16", { ResultKind::UInt, 16 })
+        .Case("UInt32", { ResultKind::UInt, 32 })
+        .Case("UInt64", { ResultKind::UInt, 64 })
+        .Case("Float", { ResultKind::Float, 32 })
+        .Case("Double", { ResultKind::Double, 64 })
+        .Case("Bool", { ResultKind::Bool, 0 })
+        .Case("String", { ResultKind::String, 0 })
+        .Default({ ResultKind::Unsupported, 0 });
+    return result;
+}
+
+// NOTE(sasha): Two functions can have the same unmangled name, but no other
+//              pair declaration types can have the same unmangled name
+//              (e.g. Function-Variable, Class-Variable, Function-Class are
+//               all not allowed. Only Function-Function is allowed).
+//              Functions are therefore also stored under their mangled name.
+static void GetDeclMapNames(swift::ValueDecl *v_decl, swift::Mangle::ASTMangler &mangler,
+                            std::string &unmangled_name, std::string &name)
+{
+    if(swift::FuncDecl *fn_decl = llvm::dyn_cast<swift::FuncDecl>(v_decl))
+    {
+        unmangled_name = fn_decl->getName().str();
+        name = mangler.mangleEntity(v_decl, false);
+    }
+    else
+    {
+        unmangled_name = v_decl->getBaseName().getIdentifier().str();
+        name = unmangled_name;
+    }
+}
+
+// Functions redeclared by a later input are removed from the file they were in, so
+// that lookups only find the new one. That is a module of their own, unless they came
+// from :load, which puts everything a file declares in one.
+static void EraseDecl(swift::SourceFile &src_file, const std::string &name,
+                      swift::Mangle::ASTMangler &mangler)
+{
+    auto is_redeclared = [&](swift::Decl *decl)
+                         {
+                             auto *v_decl = llvm::dyn_cast<swift::ValueDecl>(decl);
+                             if(!v_decl)
+                                 return false;
+                             std::string decl_unmangled_name, decl_name;
+                             GetDeclMapNames(v_decl, mangler, decl_unmangled_name, decl_name);
+                             return decl_name == name;
+                         };
+    src_file.Decls.erase(std::remove_if(src_file.Decls.begin(), src_file.Decls.end(), is_redeclared),
+                         src_file.Decls.end());
+    src_file.clearLookupCache();
+}
+
+static bool IsDeclarationModule(swift::SourceFile &src_file, const std::string &name)
+{
+    return src_file.getParentModule()->getName().str() == name;
+}
+
+swift::ValueDecl *REPL::LookupDecl(const std::string &unmangled_name)
+{
+    auto decl_iter = m_decl_map.find(unmangled_name);
+    if(decl_iter == m_decl_map.end())
+        return nullptr;
+    for(swift::Decl *decl : decl_iter->second->Decls)
+    {
+        auto *v_decl = llvm::dyn_cast<swift::ValueDecl>(decl);
+        if(v_decl && v_decl->getBaseName().getIdentifier().str() == unmangled_name)
+            return v_decl;
+    }
+    return nullptr;
+}
+
+bool REPL::IsInvalidRedeclaration(swift::ValueDecl *v_decl, const std::string &unmangled_name,
+                                  const std::string &name)
+{
+    if(llvm::isa<swift::FuncDecl>(v_decl))
+    {
+        swift::ValueDecl *existing = LookupDecl(unmangled_name);
+        if(existing && !llvm::isa<swift::FuncDecl>(existing))
+            return true;
+        // Don't allow redefinitions of any kind in playgrounds
+        return m_is_playground && m_decl_map.find(name) != m_decl_map.end();
+    }
+    return m_decl_map.find(name) != m_decl_map.end();
+}
+
+void REPL::StartInput()
 {
     m_curr_input_number++;
     m_diagnostic_engine.resetHadAnyError();
+    m_input_rejected = false;
+    m_remarks.clear();
+    m_last_result_type = ResultType();
+    m_last_result_symbol.clear();
+}
 
+bool REPL::ExecuteSwift(llvm::StringRef line)
+{
+    // Everything up to the block's end command goes to the block, commands included
+    if(m_raw_block)
+        return AddToRawBlock(line);
+    if(IsCommand(line))
+        return ExecuteCommand(line);
+
+    StartInput();
     if(IsExitString(line))
         return false;
+    return ExecuteInput(AddToSrcMgr(line), false);
+}
 
-    swift::Mangle::ASTMangler mangler;
+void REPL::LowerStaticArrays(ReplInput &input)
+{
+    std::string rewritten;
+    std::vector<LoweredLiteral> lowered_literals;
+    if(!LowerStaticArrayLiterals(m_src_mgr, m_lang_opts, input.buffer_id, rewritten, lowered_literals,
+                                 m_static_arrays))
+        return;
+    SetCurrentLoggingArea(LoggingArea::AST);
+    Log("Lowered array literals:\n" + rewritten);
+    llvm::StringRef buffer_name = m_src_mgr.getIdentifierForBuffer(input.buffer_id);
+    unsigned original_buffer_id = input.buffer_id;
+    input.buffer_id = m_src_mgr.addNewSourceBuffer(llvm::MemoryBuffer::getMemBufferCopy(rewritten, buffer_name));
+    m_lowered_buffers[input.buffer_id] = { original_buffer_id, std::move(lowered_literals) };
+}
 
-    ReplInput input = AddToSrcMgr(line);
-    auto repl_module_id = m_ast_ctx->getIdentifier("__REPL__");
-    auto *repl_module = swift::ModuleDecl::create(repl_module_id, *m_ast_ctx);
-    CHECK_ERROR();
+bool REPL::ExecuteInput(ReplInput input, bool single_module)
+{
+    LowerStaticArrays(input);
+    swift::Mangle::ASTMangler mangler;
     constexpr auto implicit_import_kind =
         swift::SourceFile::ImplicitModuleImportKind::Stdlib;
     m_invocation.getFrontendOptions().ModuleName = input.module_name.c_str();
     m_invocation.getIRGenOptions().ModuleName = input.module_name.c_str();
 
-    swift::SourceFile *tmp_src_file = new (*m_ast_ctx) swift::SourceFile(
-        *repl_module, swift::SourceFileKind::Main, input.buffer_id,
-        implicit_import_kind);
-    if(!tmp_src_file)
-    {
-        Log("Unable to create SourceFile!", LoggingPriority::Error);
-        return false;
-    }
-    repl_module->addFile(*tmp_src_file);
+    swift::SourceFile *tmp_src_file = ParseAndTypeCheck(
+        input, nullptr, m_coalesced ? &REPL::ModifyCoalescedAST : &REPL::ModifyAST);
+    if(!tmp_src_file || (m_coalesced && !m_coalesced->mergeable))
+        return true;
+    swift::ModuleDecl *repl_module = tmp_src_file->getParentModule();
 
-    CHECK_ERROR();
-    swift::PersistentParserState persistent_state(*m_ast_ctx);
-
-    bool done = false;
-    do
+    // The transform runs after ModifyAST so that it instruments the code wrapped in
+    // __repl_x. The prelude skips the global the last expression is assigned to.
+    if(m_playground_logging)
     {
-        swift::parseIntoSourceFile(*tmp_src_file,
-                                   input.buffer_id,
-                                   &done,
-                                   nullptr /* SILParserState */,
-                                   &persistent_state,
-                                   nullptr /* DelayedParseCB */,
-                                   false /* DelayBodyParsing */);
+        swift::performPlaygroundTransform(*tmp_src_file, false /* HighPerformance */);
         CHECK_ERROR();
-    } while(!done);
-    SetCurrentLoggingArea(LoggingArea::AST);
-    if(ShouldLog(LoggingPriority::Info))
-    {
-        Log("=========AST Before Modifications==========");
-        tmp_src_file->dump();
     }
-    AddImportNodes(*tmp_src_file, m_imports);
-
-    swift::performNameBinding(*tmp_src_file);
-    CHECK_ERROR();
-    swift::TopLevelContext top_level_context;
-    swift::OptionSet<swift::TypeCheckingFlags> type_check_opts;
-    swift::performTypeChecking(*tmp_src_file, top_level_context, type_check_opts);
-    
-    ModifyAST(*tmp_src_file);
-    
-    CHECK_ERROR();
-    swift::typeCheckExternalDefinitions(*tmp_src_file);
-    CHECK_ERROR();
 
+    SetCurrentLoggingArea(LoggingArea::AST);
     if(ShouldLog(LoggingPriority::Info))
     {
         Log("=========AST After Modification==========");
         tmp_src_file->dump();
     }
+    // Check every declaration before compiling any of them, so that a redeclaration
+    // doesn't leave the declarations before it in the same input behind
+    for(swift::Decl *decl : tmp_src_file->Decls)
+    {
+        if(auto *v_decl = llvm::dyn_cast<swift::ValueDecl>(decl))
+        {
+            std::string unmangled_name, name;
+            GetDeclMapNames(v_decl, mangler, unmangled_name, name);
+            if(IsInvalidRedeclaration(v_decl, unmangled_name, name))
+            {
+                // A coalesced input falls back to executing its lines one at a time,
+                // which reports this for the line that has it
+                if(!m_coalesced)
+                    std::cout << "Invalid redeclaration of " << unmangled_name << "\n";
+                m_input_rejected = true;
+                return true;
+            }
+        }
+    }
+    if(m_coalesced)
+        m_coalesced->committed = true;
+
     LoadImportedModules(*tmp_src_file);
     repl_module->collectLinkLibraries([&](swift::LinkLibrary library)
                                       {
                                           m_jit->AddDylib(library.getName().str());
                                       });
 
+    swift::SourceFile *input_file = nullptr;
+    if(single_module)
+    {
+        swift::Identifier input_module_id = m_ast_ctx->getIdentifier(input.module_name);
+        swift::ModuleDecl *input_module = swift::ModuleDecl::create(input_module_id, *m_ast_ctx);
+        input_file = new (*m_ast_ctx) swift::SourceFile(
+            *input_module, swift::SourceFileKind::Main, input.buffer_id,
+            implicit_import_kind, false);
+
+        swift::ImportDecl *input_module_import_decl = swift::ImportDecl::create(
+            *m_ast_ctx, input_file, swift::SourceLoc(),
+            swift::ImportKind::Module, swift::SourceLoc(),
+            { { input_module_id, swift::SourceLoc() } });
+        input_module_import_decl->setImplicit(true);
+        m_imports.push_back(input_module_import_decl);
+        m_ast_ctx->LoadedModules[input_module_id] = input_module;
+        input_module->addFile(*input_file);
+    }
+
     swift::FuncDecl *res_fn = nullptr;
+    swift::VarDecl *res_var = nullptr;
     for(swift::Decl *decl : tmp_src_file->Decls)
     {
         if(!llvm::isa<swift::ValueDecl>(decl))
@@ -219,40 +552,32 @@ bool REPL::ExecuteSwift(std::string line)
         swift::ValueDecl *v_decl = llvm::dyn_cast<swift::ValueDecl>(decl);
         std::string unmangled_name = "";
         std::string name = "";
-        // NOTE(sasha): Two functions can have the same unmangled name, but no other
-        //              pair declaration types can have the same unmangled name
-        //              (e.g. Function-Variable, Class-Variable, Function-Class are
-        //               all not allowed. Only Function-Function is allowed).
-        if(swift::FuncDecl *fn_decl = llvm::dyn_cast<swift::FuncDecl>(v_decl))
-        {
-            unmangled_name = fn_decl->getName().str();
-            if(unmangled_name == input.module_name)
-                res_fn = fn_decl;
+        GetDeclMapNames(v_decl, mangler, unmangled_name, name);
+        if(unmangled_name == input.module_name && llvm::isa<swift::FuncDecl>(v_decl))
+            res_fn = llvm::dyn_cast<swift::FuncDecl>(v_decl);
+        else if(unmangled_name == input.module_name + "_res" && llvm::isa<swift::VarDecl>(v_decl))
+            res_var = llvm::dyn_cast<swift::VarDecl>(v_decl);
 
-            name = mangler.mangleEntity(v_decl, false);
-            if(m_decl_map.find(unmangled_name) != m_decl_map.end())
-            {
-                assert(m_decl_map[unmangled_name]->Decls.size() == 1);
-                if(!llvm::isa<swift::FuncDecl>(m_decl_map[unmangled_name]->Decls[0]))
-                    PRINT_INVALID_REDECLARATION(unmangled_name);
-            }
-            // Don't allow redefinitions of any kind in playgrounds
-            if(m_is_playground && m_decl_map.find(name) != m_decl_map.end())
-                PRINT_INVALID_REDECLARATION(unmangled_name);
-        }
-        else
+        auto existing = m_decl_map.find(name);
+        if(single_module)
         {
-            unmangled_name = v_decl->getBaseName().getIdentifier().str();
-            name = unmangled_name;
-            if(m_decl_map.find(name) != m_decl_map.end())
-                PRINT_INVALID_REDECLARATION(name);
+            if(existing != m_decl_map.end())
+                EraseDecl(*existing->second, name, mangler);
+            m_decl_map[unmangled_name] = input_file;
+            m_decl_map[name] = input_file;
+            input_file->Decls.push_back(decl);
+            continue;
         }
+
         swift::Identifier new_module_id = m_ast_ctx->getIdentifier(name);
         swift::ModuleDecl *new_module = swift::ModuleDecl::create(new_module_id,
                                                                   *m_ast_ctx);
         swift::SourceFile *src_file;
-        if(m_decl_map.find(name) == m_decl_map.end())
+        if(existing == m_decl_map.end() || !IsDeclarationModule(*existing->second, name))
         {
+            if(existing != m_decl_map.end())
+                EraseDecl(*existing->second, name, mangler);
+
             src_file = new (*m_ast_ctx) swift::SourceFile(
                 *new_module, swift::SourceFileKind::Main, input.buffer_id,
                 implicit_import_kind, false);
@@ -285,6 +610,22 @@ bool REPL::ExecuteSwift(std::string line)
         if(!CompileSourceFileToIRAndAddToJIT(*src_file))
             return true;
     }
+    if(single_module)
+    {
+        input_file->ASTStage = swift::SourceFile::ASTStage_t::TypeChecked;
+        if(ShouldLog(LoggingPriority::Info))
+        {
+            Log(std::string("=========AST for ") + input.module_name + "==========");
+            input_file->dump();
+        }
+        if(!CompileSourceFileToIRAndAddToJIT(*input_file))
+            return true;
+    }
+
+    // Everything a coalesced input's lines would have printed before running goes
+    // out before its code runs
+    if(m_coalesced)
+        FlushCoalescedOutput();
 
     SetCurrentLoggingArea(LoggingArea::JIT);
     if(res_fn)
@@ -298,6 +639,11 @@ bool REPL::ExecuteSwift(std::string line)
             result_fn = reinterpret_cast<ReplFn>(symbol->getAddress());
             Log(std::string("Loaded function ") + mangled_fn_name);
             result_fn();
+            if(res_var)
+            {
+                m_last_result_type = GetResultType(res_var->getType());
+                m_last_result_symbol = mangler.mangleGlobalVariableFull(res_var);
+            }
         }
         else
         {
@@ -308,6 +654,560 @@ bool REPL::ExecuteSwift(std::string line)
     return true;
 }
 
+bool REPL::ExecuteSwiftLines(const std::vector<std::string> &lines)
+{
+    assert(!lines.empty());
+    // The playground transform reports locations, which would be in the combined input.
+    // Lines in a raw block aren't Swift.
+    if(lines.size() == 1 || m_playground_logging || m_raw_block)
+    {
+        for(size_t i = 0; i < lines.size(); i++)
+        {
+            if(!lines[i].empty() && !ExecuteSwift(lines[i]))
+                return false;
+        }
+        return true;
+    }
+
+    std::string text;
+    for(const std::string &line : lines)
+        text += line + "\n";
+    size_t line_count = std::count_if(lines.begin(), lines.end(),
+                                      [](const std::string &line) { return !line.empty(); });
+
+    CoalescedInput coalesced = { lines, m_curr_input_number };
+    coalesced.handler = m_diagnostic_consumer.m_handler;
+    m_diagnostic_consumer.m_handler = [&](const Diagnostic &diagnostic)
+                                      {
+                                          coalesced.diagnostics.push_back(diagnostic);
+                                      };
+    m_coalesced = &coalesced;
+    bool keep_going = ExecuteSwift(text);
+    if(coalesced.committed && !coalesced.flushed)
+        FlushCoalescedOutput();
+    m_coalesced = nullptr;
+    m_diagnostic_consumer.m_handler = coalesced.handler;
+
+    if(coalesced.committed)
+    {
+        m_curr_input_number = coalesced.first_input_number + line_count;
+        return keep_going;
+    }
+
+    // Nothing was declared, so the lines can still be executed one at a time. Whatever
+    // made them fail together is reported for the line that has it.
+    m_curr_input_number = coalesced.first_input_number;
+    for(size_t i = 0; i < lines.size(); i++)
+    {
+        if(i > 0)
+        {
+            if(!lines[i - 1].empty())
+                std::cout << "\n";
+            std::cout << m_curr_input_number << "> ";
+        }
+        if(!lines[i].empty() && !ExecuteSwift(lines[i]))
+            return false;
+    }
+    return true;
+}
+
+void REPL::PrintCoalescedPrompt(size_t line_index)
+{
+    const std::vector<std::string> &lines = m_coalesced->lines;
+    uint64_t input_number = m_coalesced->first_input_number +
+        std::count_if(lines.begin(), lines.begin() + line_index,
+                      [](const std::string &line) { return !line.empty(); });
+    // Like GetLines, a blank line only repeats the prompt
+    if(!lines[line_index - 1].empty())
+        std::cout << "\n";
+    std::cout << input_number << "> ";
+}
+
+// Prints the prompts of every line after the first, each followed by the diagnostics
+// on that line, the way they would have come out if the lines were executed one at a time
+void REPL::FlushCoalescedOutput()
+{
+    CoalescedInput &coalesced = *m_coalesced;
+    coalesced.flushed = true;
+
+    // Diagnostics without a location stay after the one before them
+    std::vector<std::pair<unsigned, const Diagnostic *>> by_line;
+    unsigned last_line = coalesced.lines.size();
+    for(const Diagnostic &diagnostic : coalesced.diagnostics)
+    {
+        if(diagnostic.line != 0)
+            last_line = std::min<unsigned>(diagnostic.line, coalesced.lines.size());
+        by_line.emplace_back(last_line, &diagnostic);
+    }
+    std::stable_sort(by_line.begin(), by_line.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    auto next = by_line.begin();
+    for(size_t i = 0; i < coalesced.lines.size(); i++)
+    {
+        if(i > 0)
+            PrintCoalescedPrompt(i);
+        for(; next != by_line.end() && next->first == i + 1; ++next)
+        {
+            if(coalesced.handler)
+                coalesced.handler(*next->second);
+            else
+                std::cout << next->second->message << std::endl;
+        }
+    }
+}
+
+// Parses and type-checks an input in a temporary module and applies ModifyAST (or
+// modify_ast) to it.
+// Nothing is added to the REPL's state, so this is also what CheckSwift uses.
+// Returns nullptr if there were errors or cancelled returned true between stages.
+swift::SourceFile *REPL::ParseAndTypeCheck(const ReplInput &input,
+                                           const std::function<bool()> &cancelled,
+                                           ModifyASTFn modify_ast)
+{
+    auto is_cancelled = [&]() { return cancelled && cancelled(); };
+
+    auto repl_module_id = m_ast_ctx->getIdentifier("__REPL__");
+    auto *repl_module = swift::ModuleDecl::create(repl_module_id, *m_ast_ctx);
+    if(m_diagnostic_engine.hadAnyError())
+        return nullptr;
+
+    swift::SourceFile *src_file = new (*m_ast_ctx) swift::SourceFile(
+        *repl_module, swift::SourceFileKind::Main, input.buffer_id,
+        swift::SourceFile::ImplicitModuleImportKind::Stdlib);
+    if(!src_file)
+    {
+        Log("Unable to create SourceFile!", LoggingPriority::Error);
+        return nullptr;
+    }
+    repl_module->addFile(*src_file);
+
+    swift::PersistentParserState persistent_state(*m_ast_ctx);
+    bool done = false;
+    do
+    {
+        swift::parseIntoSourceFile(*src_file,
+                                   input.buffer_id,
+                                   &done,
+                                   nullptr /* SILParserState */,
+                                   &persistent_state,
+                                   nullptr /* DelayedParseCB */,
+                                   false /* DelayBodyParsing */);
+        if(m_diagnostic_engine.hadAnyError() || is_cancelled())
+            return nullptr;
+    } while(!done);
+    SetCurrentLoggingArea(LoggingArea::AST);
+    if(ShouldLog(LoggingPriority::Info))
+    {
+        Log("=========AST Before Modifications==========");
+        src_file->dump();
+    }
+    AddImportNodes(*src_file, m_imports);
+
+    swift::performNameBinding(*src_file);
+    if(m_diagnostic_engine.hadAnyError() || is_cancelled())
+        return nullptr;
+    swift::TopLevelContext top_level_context;
+    swift::OptionSet<swift::TypeCheckingFlags> type_check_opts;
+    swift::performTypeChecking(*src_file, top_level_context, type_check_opts);
+
+    (this->*modify_ast)(*src_file);
+
+    if(m_diagnostic_engine.hadAnyError() || is_cancelled())
+        return nullptr;
+    swift::typeCheckExternalDefinitions(*src_file);
+    if(m_diagnostic_engine.hadAnyError())
+        return nullptr;
+    return src_file;
+}
+
+// Unlike ExecuteSwift, the file isn't split into a module per declaration, so there is
+// no indirection through function pointers and the optimizer (with --optimize) sees
+// the whole program at once. In exchange, nothing in it can be redeclared.
+bool REPL::ExecuteScript(const std::string &path)
+{
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(path);
+    if(!buffer)
+    {
+        std::cout << "Failed to read " << path << ": " << buffer.getError().message() << "\n";
+        return false;
+    }
+
+    StartInput();
+
+    ReplInput input;
+    input.module_name = "__script";
+    input.buffer_id = m_src_mgr.addNewSourceBuffer(std::move(*buffer));
+    LowerStaticArrays(input);
+    m_invocation.getFrontendOptions().ModuleName = input.module_name.c_str();
+    m_invocation.getIRGenOptions().ModuleName = input.module_name.c_str();
+
+    swift::SourceFile *src_file = ParseAndTypeCheck(input, nullptr, &REPL::ModifyScriptAST);
+    if(!src_file)
+        return false;
+
+    SetCurrentLoggingArea(LoggingArea::AST);
+    if(ShouldLog(LoggingPriority::Info))
+    {
+        Log("=========AST After Modification==========");
+        src_file->dump();
+    }
+    src_file->getParentModule()->collectLinkLibraries([&](swift::LinkLibrary library)
+                                                      {
+                                                          m_jit->AddDylib(library.getName().str());
+                                                      });
+
+    std::unique_ptr<llvm::Module> llvm_module = CompileSourceFileToIR(*src_file, false);
+    if(!llvm_module)
+        return false;
+    m_jit->AddModule(std::move(llvm_module));
+
+    SetCurrentLoggingArea(LoggingArea::JIT);
+    using MainFn = std::add_pointer<int(int, char **)>::type;
+    auto symbol = m_jit->LookupSymbol("main");
+    if(!symbol)
+    {
+        llvm::consumeError(symbol.takeError());
+        Log("Failed to load main", LoggingPriority::Error);
+        return false;
+    }
+    std::string program_name = path;
+    char *argv[] = { &program_name[0], nullptr };
+    reinterpret_cast<MainFn>(symbol->getAddress())(1, argv);
+    return true;
+}
+
+// Parses a SIL block the way the frontend parses .sil files: straight into a SILModule,
+// name binding and type-checking the Swift declarations between SIL functions as they
+// come. The module then takes the same path as SIL generated from Swift input. Its
+// functions are called from Swift through @_silgen_name declarations.
+bool REPL::ExecuteSIL(llvm::StringRef text)
+{
+    StartInput();
+    ReplInput input = AddToSrcMgr(text);
+    m_invocation.getFrontendOptions().ModuleName = input.module_name.c_str();
+    m_invocation.getIRGenOptions().ModuleName = input.module_name.c_str();
+
+    swift::ModuleDecl *module = swift::ModuleDecl::create(
+        m_ast_ctx->getIdentifier(input.module_name), *m_ast_ctx);
+    swift::SourceFile *src_file = new (*m_ast_ctx) swift::SourceFile(
+        *module, swift::SourceFileKind::SIL, input.buffer_id,
+        swift::SourceFile::ImplicitModuleImportKind::Stdlib);
+    module->addFile(*src_file);
+    // SIL can name the types declared in earlier inputs
+    AddImportNodes(*src_file, m_imports);
+
+    std::unique_ptr<swift::SILModule> sil_module =
+        swift::SILModule::createEmptyModule(module, m_invocation.getSILOptions());
+    {
+        swift::SILParserState sil_parser_state(sil_module.get());
+        swift::PersistentParserState persistent_state(*m_ast_ctx);
+        swift::TopLevelContext top_level_context;
+        swift::OptionSet<swift::TypeCheckingFlags> type_check_opts;
+        unsigned first_unchecked_decl = 0;
+        bool done = false;
+        do
+        {
+            swift::parseIntoSourceFile(*src_file,
+                                       input.buffer_id,
+                                       &done,
+                                       &sil_parser_state,
+                                       &persistent_state,
+                                       nullptr /* DelayedParseCB */,
+                                       false /* DelayBodyParsing */);
+            if(m_diagnostic_engine.hadAnyError())
+                return true;
+            swift::performNameBinding(*src_file, first_unchecked_decl);
+            swift::performTypeChecking(*src_file, top_level_context, type_check_opts, first_unchecked_decl);
+            if(m_diagnostic_engine.hadAnyError())
+                return true;
+            first_unchecked_decl = src_file->Decls.size();
+        } while(!done);
+    }
+
+    SetCurrentLoggingArea(LoggingArea::SIL);
+    if(ShouldLog(LoggingPriority::Info))
+    {
+        Log("=========Parsed SIL==========");
+        sil_module->dump();
+    }
+    std::unique_ptr<llvm::Module> llvm_module = CompileSILToIR(*src_file, std::move(sil_module));
+    if(!llvm_module)
+        return true;
+    AddToJIT(std::move(llvm_module));
+    return true;
+}
+
+// The module is added to the JIT as written, apart from the function pointer
+// indirection that lets its functions be redefined. Swift calls them through
+// @_silgen_name declarations, so they should use the swiftcc calling convention.
+bool REPL::ExecuteLLVMIR(llvm::StringRef text)
+{
+    StartInput();
+    std::string module_name = "__repl_" + std::to_string(m_curr_input_number);
+
+    llvm::SMDiagnostic parse_error;
+    std::unique_ptr<llvm::Module> llvm_module =
+        llvm::parseIR(llvm::MemoryBufferRef(text, module_name), parse_error, m_llvm_ctx);
+    std::string error;
+    llvm::raw_string_ostream error_stream(error);
+    if(!llvm_module)
+        error_stream << parse_error.getLineNo() << ":" << parse_error.getColumnNo() + 1 << ": " << parse_error.getMessage();
+    else
+        llvm::verifyModule(*llvm_module, &error_stream);
+    error_stream.flush();
+    if(!error.empty())
+    {
+        m_diagnostic_engine.diagnose(swift::SourceLoc(), swift::diag::error_parse_input_file,
+                                     module_name, llvm::StringRef(error).rtrim());
+        return true;
+    }
+
+    if(llvm_module->getDataLayout().isDefault())
+        llvm_module->setDataLayout(m_jit->GetDataLayout());
+    if(llvm_module->getTargetTriple().empty())
+        llvm_module->setTargetTriple(llvm::sys::getProcessTriple());
+    AddToJIT(std::move(llvm_module));
+    return true;
+}
+
+// Each block is compiled from its own directory in m_c_dir, next to the header and
+// module map that Swift imports it through:
+//     __repl_N/__repl_N.c
+//     __repl_N/__repl_N.h
+//     __repl_N/module.modulemap
+bool REPL::ExecuteC(llvm::StringRef text)
+{
+    StartInput();
+    std::string module_name = "__repl_" + std::to_string(m_curr_input_number);
+
+    llvm::SmallString<128> dir;
+    if(m_c_dir.empty())
+    {
+        if(std::error_code error = llvm::sys::fs::createUniqueDirectory("swift-repl-c", dir))
+        {
+            Log("Failed to create a directory for C blocks: " + error.message(), LoggingPriority::Error);
+            return true;
+        }
+        m_c_dir = dir.str();
+    }
+    dir = m_c_dir;
+    llvm::sys::path::append(dir, module_name);
+    if(std::error_code error = llvm::sys::fs::create_directory(dir))
+    {
+        Log("Failed to create " + dir.str().str() + ": " + error.message(), LoggingPriority::Error);
+        return true;
+    }
+    auto write_file = [&](const std::string &file_name, llvm::StringRef contents)
+                      {
+                          llvm::SmallString<128> path = dir;
+                          llvm::sys::path::append(path, file_name);
+                          std::error_code error;
+                          llvm::raw_fd_ostream stream(path, error, llvm::sys::fs::F_Text);
+                          if(error)
+                              Log("Failed to write " + path.str().str() + ": " + error.message(), LoggingPriority::Error);
+                          else
+                              stream << contents;
+                          return path.str().str();
+                      };
+
+    std::string header;
+    std::unique_ptr<llvm::Module> llvm_module =
+        CompileC(write_file(module_name + ".c", text), m_llvm_ctx, m_diagnostic_engine, header);
+    if(!llvm_module)
+        return true;
+    write_file(module_name + ".h", header);
+    write_file("module.modulemap",
+               "module " + module_name + " {\n"
+               "  header \"" + module_name + ".h\"\n"
+               "  export *\n"
+               "}\n");
+    if(!AddToJIT(std::move(llvm_module)))
+        return true;
+    AddModuleSearchPath(dir.str());
+    return ExecuteSwift("import " + module_name);
+}
+
+std::string REPL::GetDeclText(swift::SourceRange range)
+{
+    swift::CharSourceRange char_range = swift::Lexer::getCharSourceRangeFromSourceRange(m_src_mgr, range);
+    unsigned buffer_id = m_src_mgr.findBufferContainingLoc(range.Start);
+    auto lowered = m_lowered_buffers.find(buffer_id);
+    if(lowered == m_lowered_buffers.end())
+        return m_src_mgr.extractText(char_range).str();
+
+    // The lowered literals are shorter in the rewritten buffer, so both ends are mapped
+    // past the ones before them
+    const LoweredBuffer &lowered_buffer = lowered->second;
+    size_t begin = m_src_mgr.getLocOffsetInBuffer(char_range.getStart(), buffer_id);
+    size_t end = m_src_mgr.getLocOffsetInBuffer(char_range.getEnd(), buffer_id);
+    llvm::StringRef text = m_src_mgr.getEntireTextForBuffer(lowered_buffer.original_buffer_id);
+    return text.slice(GetOriginalOffset(lowered_buffer.literals, begin),
+                      GetOriginalOffset(lowered_buffer.literals, end)).str();
+}
+
+// The declarations are compiled from their source, as a library. Since the REPL makes
+// everything public, so does the export. Declarations are ordered as they were
+// entered, which only matters for reading the result.
+bool REPL::CompileLiveDeclarations(const std::string &module_name,
+                                   const std::string &object_path,
+                                   const std::string &module_path)
+{
+    std::vector<swift::Decl *> decls;
+    std::unordered_set<swift::Decl *> seen;
+    std::set<std::string> imports;
+    for(const auto &entry : m_decl_map)
+    {
+        for(swift::Decl *decl : entry.second->Decls)
+        {
+            auto *v_decl = llvm::dyn_cast<swift::ValueDecl>(decl);
+            // The REPL's own wrappers and result globals aren't exported
+            if(!v_decl || v_decl->getBaseName().userFacingName().startswith("__repl_"))
+                continue;
+            if(auto *var_decl = llvm::dyn_cast<swift::VarDecl>(decl))
+            {
+                if(swift::PatternBindingDecl *binding = var_decl->getParentPatternBinding())
+                    decl = binding;
+            }
+            if(seen.insert(decl).second)
+                decls.push_back(decl);
+        }
+    }
+    auto position = [&](swift::Decl *decl)
+                    {
+                        unsigned buffer_id = m_src_mgr.findBufferContainingLoc(decl->getStartLoc());
+                        return std::make_pair(buffer_id, m_src_mgr.getLocOffsetInBuffer(decl->getStartLoc(), buffer_id));
+                    };
+    std::sort(decls.begin(), decls.end(),
+              [&](swift::Decl *a, swift::Decl *b) { return position(a) < position(b); });
+    for(swift::ImportDecl *import_decl : m_imports)
+    {
+        // The REPL imports the modules it declares things in implicitly. C blocks
+        // aren't exported, so neither are their imports.
+        if(import_decl->isImplicit())
+            continue;
+        std::string name;
+        for(const auto &element : import_decl->getModulePath())
+            name += (name.empty() ? "" : ".") + element.first.str().str();
+        if(!llvm::StringRef(name).startswith("__repl_"))
+            imports.insert(name);
+    }
+
+    std::string text;
+    for(const std::string &name : imports)
+        text += "import " + name + "\n";
+    for(swift::Decl *decl : decls)
+        text += "\n" + GetDeclText(decl->getSourceRangeIncludingAttrs()) + "\n";
+    SetCurrentLoggingArea(LoggingArea::AST);
+    Log("Exported source:\n" + text);
+
+    unsigned buffer_id = m_src_mgr.addNewSourceBuffer(
+        llvm::MemoryBuffer::getMemBufferCopy(text, module_name + ".swift"));
+    swift::ModuleDecl *module = swift::ModuleDecl::create(m_ast_ctx->getIdentifier(module_name), *m_ast_ctx);
+    swift::SourceFile *src_file = new (*m_ast_ctx) swift::SourceFile(
+        *module, swift::SourceFileKind::Library, buffer_id,
+        swift::SourceFile::ImplicitModuleImportKind::Stdlib);
+    module->addFile(*src_file);
+
+    swift::PersistentParserState persistent_state(*m_ast_ctx);
+    bool done = false;
+    do
+    {
+        swift::parseIntoSourceFile(*src_file, buffer_id, &done, nullptr /* SILParserState */,
+                                   &persistent_state, nullptr /* DelayedParseCB */,
+                                   false /* DelayBodyParsing */);
+        if(m_diagnostic_engine.hadAnyError())
+            return false;
+    } while(!done);
+    swift::performNameBinding(*src_file);
+    if(m_diagnostic_engine.hadAnyError())
+        return false;
+    swift::TopLevelContext top_level_context;
+    swift::OptionSet<swift::TypeCheckingFlags> type_check_opts;
+    swift::performTypeChecking(*src_file, top_level_context, type_check_opts);
+    MakeDeclarationsPublic(*src_file);
+    if(m_diagnostic_engine.hadAnyError())
+        return false;
+    swift::typeCheckExternalDefinitions(*src_file);
+    if(m_diagnostic_engine.hadAnyError())
+        return false;
+
+    // Whole-module -O, whatever the REPL itself is using
+    swift::SILOptions sil_opts = m_invocation.getSILOptions();
+    sil_opts.DisableSILPerfOptimizations = false;
+    sil_opts.OptMode = swift::OptimizationMode::ForSpeed;
+    swift::IRGenOptions ir_opts = m_invocation.getIRGenOptions();
+    ir_opts.OptMode = swift::OptimizationMode::ForSpeed;
+    ir_opts.OutputKind = swift::IRGenOutputKind::ObjectFile;
+    ir_opts.ModuleName = module_name;
+
+    std::unique_ptr<swift::SILModule> sil_module = swift::performSILGeneration(module, sil_opts);
+    if(m_diagnostic_engine.hadAnyError())
+        return false;
+    swift::runSILDiagnosticPasses(*sil_module);
+    if(m_diagnostic_engine.hadAnyError())
+        return false;
+    swift::runSILOptimizationPasses(*sil_module);
+
+    swift::SerializationOptions serialization_opts;
+    serialization_opts.OutputPath = module_path.c_str();
+    serialization_opts.ModuleLinkName = module_name;
+    swift::serialize(module, serialization_opts, sil_module.get());
+
+    std::unique_ptr<llvm::Module> llvm_module(swift::performIRGeneration(ir_opts,
+                                                                         *src_file,
+                                                                         std::move(sil_module),
+                                                                         module_name,
+                                                                         swift::PrimarySpecificPaths(),
+                                                                         m_llvm_ctx));
+    if(!llvm_module || m_diagnostic_engine.hadAnyError())
+        return false;
+    std::unique_ptr<llvm::TargetMachine> target_machine = swift::createTargetMachine(ir_opts, *m_ast_ctx);
+    return !swift::performLLVM(ir_opts, &m_diagnostic_engine, nullptr /* DiagMutex */, nullptr /* HashGlobal */,
+                               llvm_module.get(), target_machine.get(),
+                               m_lang_opts.EffectiveLanguageVersion, object_path, nullptr /* Stats */);
+}
+
+bool REPL::CheckSwift(const std::string &text, const std::function<bool()> &cancelled)
+{
+    m_curr_input_number++;
+    m_diagnostic_engine.resetHadAnyError();
+    ReplInput input = AddToSrcMgr(text);
+    return ParseAndTypeCheck(input, cancelled) != nullptr;
+}
+
+void REPL::SetDiagnosticHandler(DiagnosticHandler handler)
+{
+    m_diagnostic_consumer.m_handler = std::move(handler);
+}
+
+void REPL::SetPrintResults(bool print)
+{
+    m_print_results = print;
+}
+
+ResultValue REPL::GetLastResult()
+{
+    if(m_last_result_type.kind == ResultKind::None)
+        return ResultValue();
+    if(m_last_result_type.kind == ResultKind::Unsupported)
+    {
+        ResultValue result;
+        result.kind = ResultKind::Unsupported;
+        return result;
+    }
+
+    auto symbol = m_jit->LookupSymbol(m_last_result_symbol);
+    if(!symbol)
+    {
+        llvm::consumeError(symbol.takeError());
+        SetCurrentLoggingArea(LoggingArea::JIT);
+        Log("Failed to find result " + m_last_result_symbol, LoggingPriority::Error);
+        return ResultValue();
+    }
+    return ReadResultValue(reinterpret_cast<const void *>(symbol->getAddress()), m_last_result_type);
+}
+
 llvm::Error REPL::UpdateFunctionPointers()
 {
     for(const auto &name : m_fn_ptr_map)
@@ -331,28 +1231,51 @@ llvm::Error REPL::UpdateFunctionPointers()
 }
 
 
-bool REPL::CompileSourceFileToIRAndAddToJIT(swift::SourceFile &src_file)
+std::unique_ptr<llvm::Module> REPL::CompileSourceFileToIR(swift::SourceFile &src_file, bool is_repl_input)
 {
     std::unique_ptr<swift::SILModule> sil_module(
         swift::performSILGeneration(src_file,
                                     m_invocation.getSILOptions()));
-    CHECK_ERROR();
-    ConfigureFunctionLinkage(src_file, sil_module);
-    swift::runSILDiagnosticPasses(*sil_module);
-    CHECK_ERROR();
+    if(m_diagnostic_engine.hadAnyError())
+        return nullptr;
+    if(is_repl_input)
+        ConfigureFunctionLinkage(src_file, sil_module);
+    return CompileSILToIR(src_file, std::move(sil_module));
+}
+
+std::unique_ptr<llvm::Module> REPL::CompileSILToIR(swift::SourceFile &src_file,
+                                                   std::unique_ptr<swift::SILModule> sil_module)
+{
+    if(sil_module->getStage() == swift::SILStage::Raw)
+    {
+        swift::runSILDiagnosticPasses(*sil_module);
+        if(m_diagnostic_engine.hadAnyError())
+            return nullptr;
+    }
+    if(m_optimize)
+        swift::runSILOptimizationPasses(*sil_module);
     SetCurrentLoggingArea(LoggingArea::SIL);
     if(ShouldLog(LoggingPriority::Info))
     {
         Log("=========SIL==========");
         sil_module->dump();
     }
-    CHECK_ERROR();
+    if(m_diagnostic_engine.hadAnyError())
+        return nullptr;
     std::unique_ptr<llvm::Module> llvm_module(swift::performIRGeneration(m_invocation.getIRGenOptions(),
                                                                          src_file,
                                                                          std::move(sil_module),
                                                                          "swift_repl_module",
                                                                          swift::PrimarySpecificPaths(),
                                                                          m_llvm_ctx));
+    if(m_optimize)
+    {
+        if(!m_target_machine)
+            m_target_machine = swift::createTargetMachine(m_invocation.getIRGenOptions(), *m_ast_ctx);
+        swift::performLLVMOptimizations(m_invocation.getIRGenOptions(),
+                                        llvm_module.get(),
+                                        m_target_machine.get());
+    }
     SetCurrentLoggingArea(LoggingArea::IR);
     if(ShouldLog(LoggingPriority::Info))
     {
@@ -367,7 +1290,19 @@ bool REPL::CompileSourceFileToIRAndAddToJIT(swift::SourceFile &src_file)
         str_stream.flush();
         Log(llvm_ir);
     }
+    return llvm_module;
+}
 
+bool REPL::CompileSourceFileToIRAndAddToJIT(swift::SourceFile &src_file)
+{
+    std::unique_ptr<llvm::Module> llvm_module = CompileSourceFileToIR(src_file, true);
+    if(!llvm_module)
+        return true;
+    return AddToJIT(std::move(llvm_module));
+}
+
+bool REPL::AddToJIT(std::unique_ptr<llvm::Module> llvm_module)
+{
     RemoveRedeclarationsFromJIT(llvm_module);
     AddFunctionPointers(llvm_module, m_jit, m_llvm_ctx, m_fn_ptr_map);
     ReplaceFunctionCallsWithIndirectFunctionCalls(llvm_module,
@@ -416,35 +1351,148 @@ void REPL::LoadImportedModules(swift::SourceFile &src_file)
 void REPL::ModifyAST(swift::SourceFile &src_file)
 {
     CombineTopLevelDeclsAndMoveToBack(src_file);
-    TransformFinalExpressionAndAddGlobal(src_file);
+    TransformFinalExpressionAndAddGlobal(src_file, m_print_results);
     WrapInFunction(src_file);
     MakeDeclarationsPublic(src_file);
 }
 
-REPL::ReplInput REPL::AddToSrcMgr(const std::string &line)
+// Scripts keep their top-level code, so SILGen emits it as main() like it would for
+// a compiled main file. Only the results of top-level expressions get printed.
+void REPL::ModifyScriptAST(swift::SourceFile &src_file)
+{
+    PrintTopLevelExpressionResults(src_file);
+}
+
+// Finds references from a declaration to declarations on later lines of the same input.
+// Executed one at a time, the line with the reference would fail to type-check.
+class ForwardReferenceFinder : public swift::ASTWalker
+{
+public:
+    ForwardReferenceFinder(swift::SourceManager &src_mgr, unsigned buffer_id, unsigned line)
+        : m_src_mgr(src_mgr), m_buffer_id(buffer_id), m_line(line)
+    {
+    }
+
+    bool found = false;
+
+private:
+    void Check(const swift::Decl *decl)
+    {
+        if(!decl || decl->getLoc().isInvalid() ||
+           m_src_mgr.findBufferContainingLoc(decl->getLoc()) != m_buffer_id)
+            return;
+        if(m_src_mgr.getLineAndColumn(decl->getLoc(), m_buffer_id).first > m_line)
+            found = true;
+    }
+
+    std::pair<bool, swift::Expr *> walkToExprPre(swift::Expr *expr) override
+    {
+        if(auto *decl_ref = llvm::dyn_cast<swift::DeclRefExpr>(expr))
+            Check(decl_ref->getDecl());
+        else if(auto *member_ref = llvm::dyn_cast<swift::MemberRefExpr>(expr))
+            Check(member_ref->getMember().getDecl());
+        return { !found, expr };
+    }
+
+    bool walkToTypeReprPre(swift::TypeRepr *type_repr) override
+    {
+        if(auto *ident = llvm::dyn_cast<swift::ComponentIdentTypeRepr>(type_repr))
+        {
+            if(ident->isBound())
+                Check(ident->getBoundDecl());
+        }
+        return !found;
+    }
+
+    bool walkToDeclPre(swift::Decl *decl) override
+    {
+        if(auto *extension = llvm::dyn_cast<swift::ExtensionDecl>(decl))
+            Check(extension->getExtendedNominal());
+        return !found;
+    }
+
+    swift::SourceManager &m_src_mgr;
+    const unsigned m_buffer_id;
+    const unsigned m_line;
+};
+
+// Lines of a coalesced input before the last may only declare functions and types.
+// Declaring those runs no code, so moving the last line's code after all of them,
+// as CombineTopLevelDeclsAndMoveToBack does, doesn't change what runs when.
+// Extensions and imports aren't among them, since ExecuteInput only compiles the
+// value declarations of an input.
+void REPL::ModifyCoalescedAST(swift::SourceFile &src_file)
+{
+    unsigned buffer_id = *src_file.getBufferID();
+    unsigned last_line = m_coalesced->lines.size();
+    for(swift::Decl *decl : src_file.Decls)
+    {
+        // Imports of earlier inputs are in here too
+        if(decl->getLoc().isInvalid() || m_src_mgr.findBufferContainingLoc(decl->getLoc()) != buffer_id)
+            continue;
+
+        unsigned line = m_src_mgr.getLineAndColumn(decl->getLoc(), buffer_id).first;
+        if(line < last_line)
+        {
+            bool runs_no_code = (llvm::isa<swift::FuncDecl>(decl) && !llvm::isa<swift::AccessorDecl>(decl)) ||
+                llvm::isa<swift::NominalTypeDecl>(decl) || llvm::isa<swift::TypeAliasDecl>(decl);
+            if(!runs_no_code)
+                m_coalesced->mergeable = false;
+        }
+
+        ForwardReferenceFinder finder(m_src_mgr, buffer_id, line);
+        decl->walk(finder);
+        if(finder.found)
+            m_coalesced->mergeable = false;
+    }
+    ModifyAST(src_file);
+}
+
+REPL::ReplInput REPL::AddToSrcMgr(llvm::StringRef line)
+{
+    std::string buffer_name = "__repl_" + std::to_string(m_curr_input_number);
+    return AddToSrcMgr(llvm::MemoryBuffer::getMemBufferCopy(line, buffer_name));
+}
+
+// The buffer is handed over as it is, so a file from MemoryBuffer::getFile is never copied
+REPL::ReplInput REPL::AddToSrcMgr(std::unique_ptr<llvm::MemoryBuffer> buffer)
 {
     ReplInput result;
-    result.text = line;
     llvm::raw_string_ostream stream(result.module_name);
     stream << "__repl_" << m_curr_input_number;
     stream.flush();
-    std::unique_ptr<llvm::MemoryBuffer> mb = llvm::MemoryBuffer::getMemBufferCopy(line, result.module_name);
-    result.buffer_id = m_src_mgr.addNewSourceBuffer(std::move(mb));
+    result.buffer_id = m_src_mgr.addNewSourceBuffer(std::move(buffer));
     return result;
 }
 
 void REPL::SetupLangOpts()
 {
+#ifdef _WIN32
     m_lang_opts.Target.setArch(llvm::Triple::ArchType::x86_64);
     m_lang_opts.Target.setOS(llvm::Triple::OSType::Win32);
     m_lang_opts.Target.setEnvironment(llvm::Triple::EnvironmentType::MSVC);
     m_lang_opts.Target.setObjectFormat(llvm::Triple::ObjectFormatType::COFF);
+#else
+    m_lang_opts.Target = llvm::Triple(llvm::sys::getProcessTriple());
+#endif
     m_lang_opts.EnableObjCInterop = false;
     m_lang_opts.EnableDollarIdentifiers = true;
     m_lang_opts.EnableAccessControl = true;
     m_lang_opts.EnableTargetOSChecking = false;
     m_lang_opts.Playground = true;
     m_lang_opts.EnableThrowWithoutTry = true;
+
+    // SIL passes only emit remarks for passes matching these patterns.
+    if(m_optimize)
+    {
+        m_lang_opts.OptimizationRemarkPassedPattern = std::make_shared<llvm::Regex>(".*");
+        m_lang_opts.OptimizationRemarkMissedPattern = std::make_shared<llvm::Regex>(".*");
+    }
+    else
+    {
+        m_lang_opts.OptimizationRemarkPassedPattern.reset();
+        m_lang_opts.OptimizationRemarkMissedPattern.reset();
+    }
 }
 
 void REPL::SetupSearchPathOpts()
@@ -455,14 +1503,31 @@ void REPL::SetupSearchPathOpts()
 void REPL::SetupSILOpts()
 {
     swift::SILOptions &sil_opts = m_invocation.getSILOptions();
-    sil_opts.DisableSILPerfOptimizations = true;
-    sil_opts.OptMode = swift::OptimizationMode::NoOptimization;
+    sil_opts.DisableSILPerfOptimizations = !m_optimize;
+    sil_opts.OptMode = m_optimize ? swift::OptimizationMode::ForSpeed :
+                                    swift::OptimizationMode::NoOptimization;
 }
 
 void REPL::SetupIROpts()
 {
     swift::IRGenOptions &ir_opts = m_invocation.getIRGenOptions();
     ir_opts.OutputKind = swift::IRGenOutputKind::Module;
+    ir_opts.OptMode = m_optimize ? swift::OptimizationMode::ForSpeed :
+                                   swift::OptimizationMode::NoOptimization;
+
+    // LLVM remarks only carry a location if there are line tables to get it from.
+    if(m_optimize)
+    {
+        ir_opts.DebugInfoLevel = swift::IRGenDebugInfoLevel::LineTables;
+        m_llvm_ctx.setDiagnosticHandler(std::make_unique<RemarkCollector>(m_remarks));
+        m_diagnostic_consumer.m_remarks = &m_remarks;
+    }
+    else
+    {
+        ir_opts.DebugInfoLevel = swift::IRGenDebugInfoLevel::None;
+        m_llvm_ctx.setDiagnosticHandler(std::make_unique<llvm::DiagnosticHandler>());
+        m_diagnostic_consumer.m_remarks = nullptr;
+    }
 }
 
 void REPL::SetupImporters()
@@ -1,11 +1,18 @@
 #ifndef REPL_H
 #define REPL_H
 
+#include <functional>
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/StringRef.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
 
 #include <swift/Subsystems.h>
 #include <swift/AST/ASTContext.h>
@@ -21,17 +28,60 @@
 
 #include "Config.h"
 #include "JIT.h"
+#include "LineReader.h"
+#include "Remarks.h"
+#include "ResultValue.h"
+#include "StaticArrays.h"
 
 struct REPL
 {
+    struct Diagnostic
+    {
+        swift::DiagnosticKind kind;
+        std::string message;
+        // 1-based, 0 if the diagnostic has no location
+        unsigned line = 0;
+        unsigned column = 0;
+    };
+    using DiagnosticHandler = std::function<void(const Diagnostic &)>;
+
+    ~REPL();
     static llvm::Expected<std::unique_ptr<REPL>> Create(
         bool is_playground = false,
         std::string default_module_cache_path = DEFAULT_MODULE_CACHE_PATH);
-    std::string GetLine();
+    // Reads the next input from stdin, printing a prompt for it and for every blank
+    // line before it. When coalesce is true, lines that are already waiting (a paste,
+    // a pipe) are read along with it as long as the ones before the last only declare
+    // functions and types. Blank lines within are kept so that ExecuteSwiftLines can
+    // print their prompts.
+    std::vector<std::string> GetLines(bool coalesce = true);
     void AddModuleSearchPath(std::string path);
     void AddLoadSearchPath(std::string path);
-    bool IsExitString(const std::string &line);
-    bool ExecuteSwift(std::string line);
+    void SetOptimizationsEnabled(bool optimize);
+    // Instruments every following input with the playground transform, which
+    // records values and execution counts into the PlaygroundLog.
+    bool EnablePlaygroundLogging();
+    bool IsExitString(llvm::StringRef line);
+    bool IsCommand(llvm::StringRef line);
+    bool LastInputHadError();
+    bool ExecuteSwift(llvm::StringRef line);
+    // Executes lines from GetLines as a single input, printing exactly what executing
+    // them one at a time would. Falls back to doing that when they can't be combined.
+    bool ExecuteSwiftLines(const std::vector<std::string> &lines);
+    // Compiles the whole file as one module and runs it, printing the result of
+    // every top-level expression. Returns false if it failed to compile.
+    bool ExecuteScript(const std::string &path);
+    // Parses and type-checks text without executing it or declaring anything.
+    // cancelled is polled between stages. Returns false on errors or cancellation.
+    bool CheckSwift(const std::string &text, const std::function<bool()> &cancelled = nullptr);
+    // Diagnostics are printed to stdout unless a handler is set
+    void SetDiagnosticHandler(DiagnosticHandler handler);
+    // Whether the result of each input is printed. It can be read with GetLastResult either way.
+    void SetPrintResults(bool print);
+    // The value of the last input's result. The kind is None if it had no result or
+    // wasn't executed, and Unsupported for types other than integers, floating point
+    // values, Bool, String and Arrays of those.
+    ResultValue GetLastResult();
 
 protected:
     explicit REPL(bool is_playground, std::string default_module_cache_path);
@@ -41,44 +91,129 @@ private:
     {
         unsigned buffer_id;
         std::string module_name;
-        std::string text;
     };
 
+    // State of the input ExecuteSwiftLines is executing
+    struct CoalescedInput
+    {
+        const std::vector<std::string> &lines;
+        // The number in the prompt of the first line
+        uint64_t first_input_number;
+        // Diagnostics are held back until it is known whether the lines are executed
+        // together, then printed after the prompt of the line they belong to
+        std::vector<Diagnostic> diagnostics;
+        DiagnosticHandler handler;
+        // Cleared when lines other than the last declare something other than functions
+        // and types, or refer to declarations on lines after them
+        bool mergeable = true;
+        // Set once the first declaration is added, after which there is no falling back
+        bool committed = false;
+        bool flushed = false;
+    };
+
+    struct LoweredBuffer
+    {
+        unsigned original_buffer_id;
+        std::vector<LoweredLiteral> literals;
+    };
+
+    void StartInput();
+    // single_module compiles all of the input's declarations together in a module named
+    // after the input, rather than each in its own module
+    bool ExecuteInput(ReplInput input, bool single_module);
+    // Switches the input to a rewritten buffer if it has array literals that
+    // LowerStaticArrayLiterals can turn into copies of static data
+    void LowerStaticArrays(ReplInput &input);
     void RemoveRedeclarationsFromJIT(std::unique_ptr<llvm::Module> &sil_module);
     llvm::Error UpdateFunctionPointers();
     bool CompileSourceFileToIRAndAddToJIT(swift::SourceFile &src_file);
+    // Makes the module's functions redeclarable through function pointers and adds it
+    bool AddToJIT(std::unique_ptr<llvm::Module> llvm_module);
+    // Returns nullptr on errors. REPL inputs get their functions' linkage adjusted for
+    // the per-declaration modules; scripts are compiled as they are.
+    std::unique_ptr<llvm::Module> CompileSourceFileToIR(swift::SourceFile &src_file, bool is_repl_input);
+    // Runs the SIL pipeline and IRGen. The mandatory passes only run if the module is
+    // still raw, since parsed SIL can already be canonical.
+    std::unique_ptr<llvm::Module> CompileSILToIR(swift::SourceFile &src_file,
+                                                 std::unique_ptr<swift::SILModule> sil_module);
+    // Raw blocks are the lines between a :xxx-begin command and its end command.
+    // They're executed together, as something other than Swift.
+    using RawBlockFn = bool (REPL::*)(llvm::StringRef text);
+    bool BeginRawBlock(llvm::StringRef end_command, RawBlockFn execute, llvm::StringRef first_lines);
+    bool AddToRawBlock(llvm::StringRef line);
+    bool ExecuteSIL(llvm::StringRef text);
+    bool ExecuteLLVMIR(llvm::StringRef text);
+    // Compiles the block with Clang, adds it to the JIT and imports it into Swift
+    // through a module generated for it
+    bool ExecuteC(llvm::StringRef text);
     void LoadImportedModules(swift::SourceFile &src_file);
     void ModifyAST(swift::SourceFile &src_file);
-    ReplInput AddToSrcMgr(const std::string &line);
+    void ModifyScriptAST(swift::SourceFile &src_file);
+    void ModifyCoalescedAST(swift::SourceFile &src_file);
+    void PrintCoalescedPrompt(size_t line_index);
+    void FlushCoalescedOutput();
+    bool IsInvalidRedeclaration(swift::ValueDecl *v_decl, const std::string &unmangled_name,
+                                const std::string &name);
+    using ModifyASTFn = void (REPL::*)(swift::SourceFile &);
+    swift::SourceFile *ParseAndTypeCheck(const ReplInput &input,
+                                         const std::function<bool()> &cancelled = nullptr,
+                                         ModifyASTFn modify_ast = &REPL::ModifyAST);
+    ReplInput AddToSrcMgr(llvm::StringRef line);
+    ReplInput AddToSrcMgr(std::unique_ptr<llvm::MemoryBuffer> buffer);
     void SetupLangOpts();
     void SetupSearchPathOpts();
     void SetupSILOpts();
     void SetupIROpts();
     void SetupImporters();
 
+    // The source of a declaration as it was written, for exporting it
+    std::string GetDeclText(swift::SourceRange range);
+    // Compiles the declarations in m_decl_map into an object file and a .swiftmodule
+    bool CompileLiveDeclarations(const std::string &module_name,
+                                 const std::string &object_path,
+                                 const std::string &module_path);
+
+    swift::ValueDecl *LookupDecl(const std::string &unmangled_name);
+    swift::NominalTypeDecl *LookupNominalType(llvm::StringRef name);
+
+    // Commands are lines starting with ':'. They are implemented in Commands.cpp.
+    bool ExecuteCommand(llvm::StringRef line);
+    bool PrintRemarksCommand(llvm::StringRef args);
+    bool LayoutCommand(llvm::StringRef args);
+    bool CheckCommand(llvm::StringRef args);
+    bool LoadCommand(llvm::StringRef args);
+    bool LinkCommand(llvm::StringRef args);
+    bool MapCommand(llvm::StringRef args);
+    bool SILBeginCommand(llvm::StringRef args);
+    bool LLVMBeginCommand(llvm::StringRef args);
+    bool CBeginCommand(llvm::StringRef args);
+    bool RawBlockEndCommand(llvm::StringRef args);
+    bool ExportCommand(llvm::StringRef args);
+    bool HelpCommand(llvm::StringRef args);
+
     class PrinterDiagnosticConsumer : public swift::DiagnosticConsumer
     {
+    public:
+        // When set, remarks are collected here instead of being printed.
+        std::vector<Remark> *m_remarks = nullptr;
+        DiagnosticHandler m_handler;
+
+    private:
         void handleDiagnostic(swift::SourceManager &src_mgr,
                               swift::SourceLoc loc,
                               swift::DiagnosticKind kind,
                               llvm::StringRef fmt_str,
                               llvm::ArrayRef<swift::DiagnosticArgument> fmt_args,
                               const swift::DiagnosticInfo &info,
-                              const swift::SourceLoc)
-        {
-            //NOTE(sasha): We don't use normal logging system here because we always
-            //             want to show compiler errors.
-            std::string diagnostic;
-            llvm::raw_string_ostream stream(diagnostic);
-            swift::DiagnosticEngine::formatDiagnosticText(stream, fmt_str, fmt_args);
-            stream.flush();
-            std::cout << diagnostic << std::endl;
-        }
+                              const swift::SourceLoc) override;
     };
 
     const bool m_is_playground;
     const std::string m_default_module_cache_path;
     uint64_t m_curr_input_number;
+    bool m_optimize;
+    bool m_playground_logging;
+    bool m_print_results = true;
 
     swift::CompilerInvocation m_invocation;
     
@@ -90,6 +225,18 @@ private:
     PrinterDiagnosticConsumer m_diagnostic_consumer;
 
     llvm::LLVMContext m_llvm_ctx;
+    std::unique_ptr<llvm::TargetMachine> m_target_machine;
+
+    // The global the last executed input's result was assigned to
+    ResultType m_last_result_type;
+    std::string m_last_result_symbol;
+    // Set when the most recent input was rejected without a diagnostic, like an
+    // invalid redeclaration
+    bool m_input_rejected = false;
+
+    // Optimization remarks for the most recent input. Only collected when
+    // optimizations are enabled.
+    std::vector<Remark> m_remarks;
 
     std::unique_ptr<swift::ASTContext> m_ast_ctx;
 
@@ -99,5 +246,30 @@ private:
     std::vector<swift::ImportDecl *> m_imports;
 
     std::unique_ptr<JIT> m_jit;
+
+    LineReader m_line_reader;
+    // Lines GetLines read but couldn't add to the input it returned. Their prompts
+    // haven't been printed yet.
+    std::vector<std::string> m_pending_lines;
+    CoalescedInput *m_coalesced = nullptr;
+
+    struct RawBlock
+    {
+        std::string end_command;
+        RawBlockFn execute;
+        std::string text;
+    };
+    // Set between a :xxx-begin command and its end command
+    llvm::Optional<RawBlock> m_raw_block;
+
+    // Data of the array literals lowered by LowerStaticArrays. Compiled code copies out
+    // of them every time the literal is evaluated.
+    std::vector<std::unique_ptr<uint64_t[]>> m_static_arrays;
+    // Buffers with lowered literals, to the buffers they were rewritten from
+    std::unordered_map<unsigned, LoweredBuffer> m_lowered_buffers;
+    // Files mapped with :map. Globals in the JIT point into them.
+    std::vector<std::unique_ptr<llvm::sys::fs::mapped_file_region>> m_mapped_files;
+    // Temporary directory holding the files of :c-begin blocks, removed with the REPL
+    std::string m_c_dir;
 };
 #endif
@@ -0,0 +1,93 @@
+#include "Remarks.h"
+
+#include <iostream>
+#include <string>
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Path.h>
+
+bool RemarkCollector::handleDiagnostics(const llvm::DiagnosticInfo &info)
+{
+    auto *opt_info = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&info);
+    if(!opt_info)
+        return false;
+
+    Remark remark;
+    switch(info.getKind())
+    {
+    case llvm::DK_OptimizationRemark:
+        remark.kind = RemarkKind::Passed;
+        break;
+    case llvm::DK_OptimizationRemarkMissed:
+        remark.kind = RemarkKind::Missed;
+        break;
+    default:
+        remark.kind = RemarkKind::Analysis;
+        break;
+    }
+    remark.origin = "LLVM";
+    remark.pass = opt_info->getPassName().str();
+    remark.message = opt_info->getMsg();
+    if(opt_info->isLocationAvailable())
+    {
+        llvm::DiagnosticLocation loc = opt_info->getLocation();
+        remark.buffer_name = llvm::sys::path::filename(loc.getRelativePath()).str();
+        remark.line = loc.getLine();
+        remark.column = loc.getColumn();
+    }
+    m_remarks.push_back(std::move(remark));
+    return true;
+}
+
+static const char *RemarkKindString(RemarkKind kind)
+{
+    switch(kind)
+    {
+    case RemarkKind::Passed:
+        return "passed";
+    case RemarkKind::Missed:
+        return "missed";
+    case RemarkKind::Analysis:
+        return "analysis";
+    }
+    return "";
+}
+
+static llvm::StringRef GetLineText(swift::SourceManager &src_mgr, unsigned buffer_id, unsigned line)
+{
+    llvm::StringRef text = src_mgr.getEntireTextForBuffer(buffer_id);
+    for(unsigned curr_line = 1; curr_line < line && !text.empty(); curr_line++)
+        text = text.split('\n').second;
+    return text.split('\n').first.rtrim("\r");
+}
+
+void PrintRemarks(const std::vector<Remark> &remarks, swift::SourceManager &src_mgr)
+{
+    if(remarks.empty())
+    {
+        std::cout << "No optimization remarks for the last input\n";
+        return;
+    }
+
+    for(const Remark &remark : remarks)
+    {
+        std::cout << RemarkKindString(remark.kind) << " (" << remark.origin;
+        if(!remark.pass.empty())
+            std::cout << ", " << remark.pass;
+        std::cout << ")";
+
+        llvm::Optional<unsigned> buffer_id;
+        if(!remark.buffer_name.empty())
+            buffer_id = src_mgr.getIDForBufferIdentifier(remark.buffer_name);
+        if(buffer_id && remark.line != 0)
+            std::cout << " " << remark.buffer_name << ":" << remark.line << ":" << remark.column;
+        std::cout << ": " << remark.message << "\n";
+
+        if(buffer_id && remark.line != 0)
+        {
+            std::cout << "    " << GetLineText(src_mgr, *buffer_id, remark.line).str() << "\n";
+            if(remark.column != 0)
+                std::cout << "    " << std::string(remark.column - 1, ' ') << "^\n";
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef REMARKS_H
+#define REMARKS_H
+
+#include <string>
+#include <vector>
+
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+
+#include <swift/Basic/SourceManager.h>
+
+// Remarks are collected from two places:
+//  - SIL passes report remarks through the DiagnosticEngine as
+//    DiagnosticKind::Remark, which the REPL's diagnostic consumer forwards
+//    here instead of printing.
+//  - LLVM passes report remarks through the LLVMContext's DiagnosticHandler,
+//    which is RemarkCollector below. Their locations come from line tables,
+//    whose file name is the __repl_x buffer identifier.
+// Both are mapped back to a (buffer, line, column) in the REPL's SourceManager.
+
+enum class RemarkKind
+{
+    Passed,
+    Missed,
+    Analysis,
+};
+
+struct Remark
+{
+    RemarkKind kind;
+    std::string origin; // "SIL" or "LLVM"
+    std::string pass;
+    std::string message;
+    std::string buffer_name;
+    unsigned line = 0;
+    unsigned column = 0;
+};
+
+class RemarkCollector : public llvm::DiagnosticHandler
+{
+public:
+    explicit RemarkCollector(std::vector<Remark> &remarks) : m_remarks(remarks) {}
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &info) override;
+    bool isAnalysisRemarkEnabled(llvm::StringRef) const override { return true; }
+    bool isMissedOptRemarkEnabled(llvm::StringRef) const override { return true; }
+    bool isPassedOptRemarkEnabled(llvm::StringRef) const override { return true; }
+    bool isAnyRemarkEnabled() const override { return true; }
+
+private:
+    std::vector<Remark> &m_remarks;
+};
+
+void PrintRemarks(const std::vector<Remark> &remarks, swift::SourceManager &src_mgr);
+
+#endif
@@ -0,0 +1,130 @@
+#include "ResultValue.h"
+
+#include <cstring>
+
+// String layout (see StringObject.swift in the standard library)
+#define STRING_DISCRIMINATOR_SHIFT 56
+#define STRING_IS_SMALL 0x20
+#define STRING_IS_BRIDGED_OR_FOREIGN 0x50
+#define STRING_SMALL_COUNT_MASK 0x0F
+#define STRING_ADDRESS_MASK 0x0FFFFFFFFFFFFFFFull
+#define STRING_IS_TAIL_ALLOCATED (1ull << 60)
+#define STRING_COUNT_MASK 0x0000FFFFFFFFFFFFull
+#define STRING_STORAGE_BIAS 32
+
+// Array layout (see ArrayBody.swift and ContiguousArrayBuffer.swift)
+#define ARRAY_COUNT_OFFSET 16
+#define ARRAY_ELEMENTS_OFFSET 32
+
+template <typename T>
+static T Load(const void *address)
+{
+    T value;
+    memcpy(&value, address, sizeof(T));
+    return value;
+}
+
+static size_t Stride(ResultKind kind, unsigned bit_width)
+{
+    switch(kind)
+    {
+    case ResultKind::Int:
+    case ResultKind::UInt:
+    case ResultKind::Float:
+    case ResultKind::Double:
+        return bit_width / 8;
+    case ResultKind::Bool:
+        return 1;
+    case ResultKind::String:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static void ReadString(const void *address, ResultValue &value)
+{
+    uint64_t count_and_flags = Load<uint64_t>(address);
+    uint64_t object = Load<uint64_t>(static_cast<const char *>(address) + 8);
+    uint8_t discriminator = static_cast<uint8_t>(object >> STRING_DISCRIMINATOR_SHIFT);
+
+    if(discriminator & STRING_IS_SMALL)
+    {
+        // The code units are the first bytes of the two words
+        value.data = address;
+        value.count = discriminator & STRING_SMALL_COUNT_MASK;
+    }
+    else if(!(discriminator & STRING_IS_BRIDGED_OR_FOREIGN) && (count_and_flags & STRING_IS_TAIL_ALLOCATED))
+    {
+        value.data = reinterpret_cast<const void *>((object & STRING_ADDRESS_MASK) + STRING_STORAGE_BIAS);
+        value.count = count_and_flags & STRING_COUNT_MASK;
+    }
+    else
+    {
+        value.kind = ResultKind::Unsupported;
+    }
+}
+
+ResultValue ReadResultValue(const void *address, const ResultType &type)
+{
+    ResultValue value;
+    value.kind = type.kind;
+    value.bit_width = type.bit_width;
+    switch(type.kind)
+    {
+    case ResultKind::Int:
+        switch(type.bit_width)
+        {
+        case 8: value.int_value = Load<int8_t>(address); break;
+        case 16: value.int_value = Load<int16_t>(address); break;
+        case 32: value.int_value = Load<int32_t>(address); break;
+        default: value.int_value = Load<int64_t>(address); break;
+        }
+        break;
+    case ResultKind::UInt:
+        switch(type.bit_width)
+        {
+        case 8: value.uint_value = Load<uint8_t>(address); break;
+        case 16: value.uint_value = Load<uint16_t>(address); break;
+        case 32: value.uint_value = Load<uint32_t>(address); break;
+        default: value.uint_value = Load<uint64_t>(address); break;
+        }
+        break;
+    case ResultKind::Float:
+        value.float_value = Load<float>(address);
+        break;
+    case ResultKind::Double:
+        value.float_value = Load<double>(address);
+        break;
+    case ResultKind::Bool:
+        value.bool_value = (Load<uint8_t>(address) & 1) != 0;
+        break;
+    case ResultKind::String:
+        ReadString(address, value);
+        break;
+    case ResultKind::Array:
+    {
+        const char *storage = Load<const char *>(address);
+        value.count = static_cast<size_t>(Load<int64_t>(storage + ARRAY_COUNT_OFFSET));
+        value.data = storage + ARRAY_ELEMENTS_OFFSET;
+        value.element_kind = type.element_kind;
+        value.element_bit_width = type.element_bit_width;
+        value.element_stride = Stride(type.element_kind, type.element_bit_width);
+        break;
+    }
+    case ResultKind::None:
+    case ResultKind::Unsupported:
+        break;
+    }
+    return value;
+}
+
+ResultValue ResultValue::GetElement(size_t index) const
+{
+    ResultType type;
+    type.kind = element_kind;
+    type.bit_width = element_bit_width;
+    if(kind != ResultKind::Array || index >= count)
+        return ResultValue();
+    return ReadResultValue(static_cast<const char *>(data) + index * element_stride, type);
+}
@@ -0,0 +1,69 @@
+#ifndef RESULT_VALUE_H
+#define RESULT_VALUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The result of an input, read straight from the memory of the __repl_x_res global it
+// was assigned to, for hosts that want values rather than printed text.
+//
+// Reading it relies on the layout of the standard library's types on 64-bit
+// little-endian targets:
+//  - Integers, Float, Double and Bool are stored as themselves.
+//  - An Array is a pointer to a heap object: a 16 byte object header, the count and
+//    the capacity, then the elements.
+//  - A String is two words, the count and flags and then the object. Small strings
+//    (at most 15 UTF-8 code units) are stored in those words; otherwise the object holds
+//    the address of the code units minus 32.
+
+enum class ResultKind
+{
+    None,
+    Int,
+    UInt,
+    Float,
+    Double,
+    Bool,
+    String,
+    Array,
+    // Any other type, or a String that isn't stored contiguously as UTF-8
+    Unsupported,
+};
+
+// How a value is laid out, as determined from its Swift type
+struct ResultType
+{
+    ResultKind kind = ResultKind::None;
+    // Of Int, UInt (8 to 64), Float (32) and Double (64)
+    unsigned bit_width = 0;
+    // Of the elements of an Array, which can't be Arrays themselves
+    ResultKind element_kind = ResultKind::None;
+    unsigned element_bit_width = 0;
+};
+
+struct ResultValue
+{
+    ResultKind kind = ResultKind::None;
+    unsigned bit_width = 0;
+    int64_t int_value = 0;
+    uint64_t uint_value = 0;
+    // Float values are widened
+    double float_value = 0.0;
+    bool bool_value = false;
+
+    // A String's UTF-8 code units or an Array's elements, element_stride bytes apart.
+    // Neither is null-terminated. They point into storage kept alive by the result
+    // global, so they stay valid for as long as the REPL.
+    const void *data = nullptr;
+    size_t count = 0;
+    ResultKind element_kind = ResultKind::None;
+    unsigned element_bit_width = 0;
+    size_t element_stride = 0;
+
+    // Reads an element of an Array
+    ResultValue GetElement(size_t index) const;
+};
+
+ResultValue ReadResultValue(const void *address, const ResultType &type);
+
+#endif
@@ -0,0 +1,103 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+static size_t RoundUpToPowerOfTwo(size_t size)
+{
+    size_t result = 1;
+    while(result < size)
+        result <<= 1;
+    return result;
+}
+
+RingBuffer::RingBuffer(size_t capacity)
+    : m_capacity(RoundUpToPowerOfTwo(capacity)),
+      m_mask(m_capacity - 1),
+      m_data(new char[m_capacity]),
+      m_write_index(0),
+      m_read_index(0)
+{
+}
+
+size_t RingBuffer::ReadableSize() const
+{
+    return static_cast<size_t>(m_write_index.load(std::memory_order_acquire) -
+                               m_read_index.load(std::memory_order_acquire));
+}
+
+size_t RingBuffer::WritableSize() const
+{
+    return m_capacity - ReadableSize();
+}
+
+char *RingBuffer::WritePointer(size_t &contiguous_size)
+{
+    uint64_t write_index = m_write_index.load(std::memory_order_relaxed);
+    uint64_t read_index = m_read_index.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(write_index & m_mask);
+    size_t free_size = m_capacity - static_cast<size_t>(write_index - read_index);
+    contiguous_size = std::min(free_size, m_capacity - offset);
+    return m_data.get() + offset;
+}
+
+void RingBuffer::CommitWrite(size_t size)
+{
+    m_write_index.store(m_write_index.load(std::memory_order_relaxed) + size,
+                        std::memory_order_release);
+}
+
+bool RingBuffer::Write(const void *data, size_t size)
+{
+    if(WritableSize() < size)
+        return false;
+
+    const char *bytes = static_cast<const char *>(data);
+    while(size > 0)
+    {
+        size_t contiguous_size;
+        char *dest = WritePointer(contiguous_size);
+        size_t chunk = std::min(size, contiguous_size);
+        std::memcpy(dest, bytes, chunk);
+        CommitWrite(chunk);
+        bytes += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+const char *RingBuffer::ReadPointer(size_t &contiguous_size)
+{
+    uint64_t read_index = m_read_index.load(std::memory_order_relaxed);
+    uint64_t write_index = m_write_index.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(read_index & m_mask);
+    contiguous_size = std::min(static_cast<size_t>(write_index - read_index), m_capacity - offset);
+    return m_data.get() + offset;
+}
+
+void RingBuffer::CommitRead(size_t size)
+{
+    m_read_index.store(m_read_index.load(std::memory_order_relaxed) + size,
+                       std::memory_order_release);
+}
+
+bool RingBuffer::Peek(void *data, size_t size)
+{
+    if(ReadableSize() < size)
+        return false;
+
+    uint64_t read_index = m_read_index.load(std::memory_order_relaxed);
+    size_t offset = static_cast<size_t>(read_index & m_mask);
+    size_t first = std::min(size, m_capacity - offset);
+    std::memcpy(data, m_data.get() + offset, first);
+    std::memcpy(static_cast<char *>(data) + first, m_data.get(), size - first);
+    return true;
+}
+
+bool RingBuffer::Read(void *data, size_t size)
+{
+    if(!Peek(data, size))
+        return false;
+    CommitRead(size);
+    return true;
+}
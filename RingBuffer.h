@@ -0,0 +1,49 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A bounded, lock-free byte queue for exactly one producer thread and one consumer
+// thread. Both sides can work in place: the producer asks for a contiguous region to
+// write into and commits what it wrote, and the consumer does the same for reading.
+// A region never wraps, so a full read or write can take two calls.
+class RingBuffer
+{
+public:
+    // The capacity is rounded up to a power of two
+    explicit RingBuffer(size_t capacity);
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    size_t Capacity() const { return m_capacity; }
+    size_t ReadableSize() const;
+    size_t WritableSize() const;
+
+    // Producer side
+    char *WritePointer(size_t &contiguous_size);
+    void CommitWrite(size_t size);
+    // Writes all of data or nothing. Returns false if there isn't enough space.
+    bool Write(const void *data, size_t size);
+
+    // Consumer side
+    const char *ReadPointer(size_t &contiguous_size);
+    void CommitRead(size_t size);
+    // Copy size bytes out, across the wrap if needed. Both return false and leave the
+    // buffer untouched if fewer than size bytes are readable; Peek doesn't consume them.
+    bool Peek(void *data, size_t size);
+    bool Read(void *data, size_t size);
+
+private:
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<char[]> m_data;
+    // Both only ever increase; their difference is the number of readable bytes.
+    // Kept on separate cache lines since they are written by different threads.
+    alignas(64) std::atomic<uint64_t> m_write_index;
+    alignas(64) std::atomic<uint64_t> m_read_index;
+};
+
+#endif
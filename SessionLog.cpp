@@ -0,0 +1,109 @@
+#include "SessionLog.h"
+#include "Logging.h"
+
+#include <chrono>
+#include <ctime>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#define SESSION_LOG_HEADER "# swift-repl session log v1"
+
+static std::string Escape(const std::string &input)
+{
+    std::string result;
+    result.reserve(input.size());
+    for(char c : input)
+    {
+        switch(c)
+        {
+        case '\\': result += "\\\\"; break;
+        case '\t': result += "\\t"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        default: result += c; break;
+        }
+    }
+    return result;
+}
+
+static std::string Unescape(llvm::StringRef input)
+{
+    std::string result;
+    result.reserve(input.size());
+    for(size_t i = 0; i < input.size(); i++)
+    {
+        if(input[i] != '\\' || i + 1 == input.size())
+        {
+            result += input[i];
+            continue;
+        }
+        switch(input[++i])
+        {
+        case 't': result += '\t'; break;
+        case 'n': result += '\n'; break;
+        case 'r': result += '\r'; break;
+        default: result += input[i]; break;
+        }
+    }
+    return result;
+}
+
+bool SessionRecorder::Open(const std::string &path)
+{
+    m_file.open(path, std::ios::out | std::ios::trunc);
+    if(!m_file)
+        return false;
+
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char time_str[64];
+    std::strftime(time_str, sizeof(time_str), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    m_file << SESSION_LOG_HEADER << " started " << time_str << "\n";
+    m_file.flush();
+    return true;
+}
+
+void SessionRecorder::Record(const SessionLogEntry &entry)
+{
+    if(!m_file)
+        return;
+    m_file << entry.start_us << '\t'
+           << entry.duration_us << '\t'
+           << (entry.succeeded ? "ok" : "error") << '\t'
+           << Escape(entry.input) << '\n';
+    // Flush every entry so that a crashing input still ends up in the log
+    m_file.flush();
+}
+
+bool ReadSessionLog(const std::string &path, std::vector<SessionLogEntry> &entries)
+{
+    SetCurrentLoggingArea(LoggingArea::All);
+    std::ifstream file(path);
+    if(!file)
+    {
+        Log("Failed to open session log " + path, LoggingPriority::Error);
+        return false;
+    }
+
+    std::string line;
+    for(int line_number = 1; std::getline(file, line); line_number++)
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+
+        llvm::SmallVector<llvm::StringRef, 4> fields;
+        llvm::StringRef(line).split(fields, '\t', 3);
+        SessionLogEntry entry;
+        if(fields.size() != 4 ||
+           fields[0].getAsInteger(10, entry.start_us) ||
+           fields[1].getAsInteger(10, entry.duration_us))
+        {
+            Log(path + ":" + std::to_string(line_number) + ": malformed session log entry", LoggingPriority::Error);
+            return false;
+        }
+        entry.succeeded = fields[2] == "ok";
+        entry.input = Unescape(fields[3]);
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
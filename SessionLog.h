@@ -0,0 +1,36 @@
+#ifndef SESSION_LOG_H
+#define SESSION_LOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A session log has one line per input:
+//     <start offset in us> <TAB> <duration in us> <TAB> <ok|error> <TAB> <escaped input>
+// Start offsets are relative to the start of the session, whose wall clock time is
+// recorded in the header. Backslashes, tabs and newlines in the input are escaped.
+
+struct SessionLogEntry
+{
+    uint64_t start_us;
+    uint64_t duration_us;
+    bool succeeded;
+    std::string input;
+};
+
+class SessionRecorder
+{
+public:
+    // Returns false if the file could not be opened
+    bool Open(const std::string &path);
+    void Record(const SessionLogEntry &entry);
+
+private:
+    std::ofstream m_file;
+};
+
+// Returns false if the file could not be opened or is malformed
+bool ReadSessionLog(const std::string &path, std::vector<SessionLogEntry> &entries);
+
+#endif
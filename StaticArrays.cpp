@@ -0,0 +1,320 @@
+#include "StaticArrays.h"
+
+#include <climits>
+#include <cstring>
+#include <tuple>
+
+#include <llvm/ADT/APFloat.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <swift/Parse/Token.h>
+#include <swift/Subsystems.h>
+
+// Smaller literals compile quickly enough as they are
+static constexpr size_t MIN_STATIC_ARRAY_ELEMENTS = 256;
+
+struct ElementType
+{
+    llvm::StringRef name;
+    unsigned bit_width = 0;
+    bool is_signed = false;
+    bool is_float = false;
+};
+
+struct LiteralElement
+{
+    const swift::Token *token;
+    bool negative;
+};
+
+static bool GetElementType(llvm::StringRef name, ElementType &type)
+{
+    constexpr unsigned int_width = sizeof(intptr_t) * CHAR_BIT;
+    type.name = name;
+    std::tie(type.bit_width, type.is_signed, type.is_float) =
+        llvm::StringSwitch<std::tuple<unsigned, bool, bool>>(type.name)
+        .Case("Int", std::make_tuple(int_width, true, false))
+        .Case("Int8", std::make_tuple(8, true, false))
+        .Case("Int16", std::make_tuple(16, true, false))
+        .Case("Int32", std::make_tuple(32, true, false))
+        .Case("Int64", std::make_tuple(64, true, false))
+        .Case("UInt", std::make_tuple(int_width, false, false))
+        .Case("UInt8", std::make_tuple(8, false, false))
+        .Case("UInt16", std::make_tuple(16, false, false))
+        .Case("UInt32", std::make_tuple(32, false, false))
+        .Case("UInt64", std::make_tuple(64, false, false))
+        .Case("Float", std::make_tuple(32, true, true))
+        .Case("Double", std::make_tuple(64, true, true))
+        .Default(std::make_tuple(0, false, false));
+    return type.bit_width != 0;
+}
+
+// Reads [T] starting at tokens[begin]
+static bool GetArrayElementType(llvm::ArrayRef<swift::Token> tokens, size_t begin, ElementType &type)
+{
+    return begin + 2 < tokens.size() &&
+           tokens[begin].is(swift::tok::l_square) &&
+           tokens[begin + 1].is(swift::tok::identifier) &&
+           GetElementType(tokens[begin + 1].getText(), type) &&
+           tokens[begin + 2].is(swift::tok::r_square);
+}
+
+static std::string WithoutUnderscores(llvm::StringRef text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for(char c : text)
+    {
+        if(c != '_')
+            result.push_back(c);
+    }
+    return result;
+}
+
+static bool ParseIntegerLiteral(const LiteralElement &element, llvm::APInt &value)
+{
+    std::string digits = WithoutUnderscores(element.token->getText());
+    llvm::StringRef rest = digits;
+    unsigned radix = 10;
+    if(rest.consume_front("0x"))
+        radix = 16;
+    else if(rest.consume_front("0o"))
+        radix = 8;
+    else if(rest.consume_front("0b"))
+        radix = 2;
+
+    llvm::APInt magnitude;
+    if(rest.getAsInteger(radix, magnitude))
+        return false;
+    // One more bit, so that the magnitude can't be mistaken for a negative number
+    value = magnitude.zext(magnitude.getBitWidth() + 1);
+    if(element.negative)
+        value.negate();
+    return true;
+}
+
+static void StoreBits(uint64_t bits, unsigned bit_width, char *out)
+{
+    switch(bit_width)
+    {
+    case 8:
+    {
+        uint8_t value = static_cast<uint8_t>(bits);
+        std::memcpy(out, &value, sizeof(value));
+        break;
+    }
+    case 16:
+    {
+        uint16_t value = static_cast<uint16_t>(bits);
+        std::memcpy(out, &value, sizeof(value));
+        break;
+    }
+    case 32:
+    {
+        uint32_t value = static_cast<uint32_t>(bits);
+        std::memcpy(out, &value, sizeof(value));
+        break;
+    }
+    default:
+        std::memcpy(out, &bits, sizeof(bits));
+        break;
+    }
+}
+
+// Float literals are converted to _MaxBuiltinFloatType first, and then rounded again
+// to the element type by its init(_builtinFloatLiteral:)
+static const llvm::fltSemantics &GetMaxBuiltinFloatSemantics()
+{
+#if !defined(_WIN32) && (defined(__x86_64__) || defined(__i386__))
+    return llvm::APFloat::x87DoubleExtended();
+#else
+    return llvm::APFloat::IEEEdouble();
+#endif
+}
+
+// Returns false if the literal isn't valid for the type. The literal is then left
+// alone for the type checker to report.
+static bool EncodeElement(const LiteralElement &element, const ElementType &type, char *out)
+{
+    bool is_float_literal = element.token->is(swift::tok::floating_literal);
+    if(!type.is_float)
+    {
+        llvm::APInt value;
+        if(is_float_literal || !ParseIntegerLiteral(element, value))
+            return false;
+        bool fits = type.is_signed ?
+            value.isSignedIntN(type.bit_width) :
+            !value.isNegative() && value.isIntN(type.bit_width);
+        if(!fits)
+            return false;
+        StoreBits(value.sextOrTrunc(64).getZExtValue(), type.bit_width, out);
+        return true;
+    }
+
+    const llvm::fltSemantics &semantics =
+        type.bit_width == 32 ? llvm::APFloat::IEEEsingle() : llvm::APFloat::IEEEdouble();
+    llvm::APFloat value(semantics);
+    if(is_float_literal)
+    {
+        std::string digits = WithoutUnderscores(element.token->getText());
+        if(element.negative)
+            digits.insert(digits.begin(), '-');
+        value = llvm::APFloat(GetMaxBuiltinFloatSemantics(), digits);
+        bool loses_info;
+        value.convert(semantics, llvm::APFloat::rmNearestTiesToEven, &loses_info);
+    }
+    else
+    {
+        llvm::APInt int_value;
+        if(!ParseIntegerLiteral(element, int_value))
+            return false;
+        value.convertFromAPInt(int_value, true, llvm::APFloat::rmNearestTiesToEven);
+    }
+    StoreBits(value.bitcastToAPInt().getZExtValue(), type.bit_width, out);
+    return true;
+}
+
+// Whether a literal starting a line after this token starts a new statement
+static bool EndsStatement(const swift::Token &token)
+{
+    return token.isAny(swift::tok::integer_literal, swift::tok::floating_literal,
+                       swift::tok::string_literal, swift::tok::identifier,
+                       swift::tok::r_paren, swift::tok::r_square,
+                       swift::tok::r_brace, swift::tok::semi);
+}
+
+bool LowerStaticArrayLiterals(const swift::SourceManager &src_mgr,
+                              const swift::LangOptions &lang_opts,
+                              unsigned buffer_id,
+                              std::string &rewritten,
+                              std::vector<LoweredLiteral> &lowered_literals,
+                              std::vector<std::unique_ptr<uint64_t[]>> &blobs)
+{
+    std::vector<swift::Token> tokens = swift::tokenize(lang_opts, src_mgr, buffer_id,
+                                                       0, 0, nullptr, false /* KeepComments */);
+    llvm::StringRef text = src_mgr.getEntireTextForBuffer(buffer_id);
+
+    rewritten.clear();
+    lowered_literals.clear();
+    llvm::raw_string_ostream stream(rewritten);
+    size_t copied_until = 0;
+    bool lowered = false;
+    // Literals are skipped over whole, and have no braces in them
+    int brace_depth = 0;
+    for(size_t i = 0; i < tokens.size(); i++)
+    {
+        if(tokens[i].is(swift::tok::l_brace))
+            brace_depth++;
+        else if(tokens[i].is(swift::tok::r_brace))
+            brace_depth--;
+        if(!tokens[i].is(swift::tok::l_square))
+            continue;
+
+        std::vector<LiteralElement> elements;
+        bool has_float_literal = false;
+        size_t end = i + 1;
+        while(end < tokens.size())
+        {
+            bool negative = tokens[end].is(swift::tok::oper_prefix) && tokens[end].getText() == "-";
+            if(negative)
+                end++;
+            if(end >= tokens.size() ||
+               !tokens[end].isAny(swift::tok::integer_literal, swift::tok::floating_literal))
+                break;
+            elements.push_back({ &tokens[end], negative });
+            has_float_literal |= tokens[end].is(swift::tok::floating_literal);
+            end++;
+            if(end >= tokens.size() || !tokens[end].is(swift::tok::comma))
+                break;
+            end++;
+        }
+        if(end >= tokens.size() || !tokens[end].is(swift::tok::r_square) ||
+           elements.size() < MIN_STATIC_ARRAY_ELEMENTS)
+            continue;
+
+        // The element type has to be known from the source alone, so only literals that
+        // make up the whole initializer of a binding or top-level statement are lowered:
+        //     ... name: [T] = [...]
+        //     let/var name = [...]
+        //     [...]
+        // optionally followed by as [T]. Within braces a statement can be the implicit
+        // return of a closure or function, which gets its type from the context.
+        ElementType type, as_type;
+        bool has_type = i >= 5 && tokens[i - 1].is(swift::tok::equal) &&
+                        tokens[i - 5].is(swift::tok::colon) &&
+                        GetArrayElementType(tokens, i - 4, type);
+        bool is_untyped_binding = i >= 3 && tokens[i - 1].is(swift::tok::equal) &&
+                                  tokens[i - 2].is(swift::tok::identifier) &&
+                                  tokens[i - 3].isAny(swift::tok::kw_let, swift::tok::kw_var);
+        bool is_statement = brace_depth == 0 &&
+                            (i == 0 || tokens[i - 1].is(swift::tok::semi) ||
+                             (tokens[i].isAtStartOfLine() && EndsStatement(tokens[i - 1])));
+
+        size_t after = end + 1;
+        if(after < tokens.size() && tokens[after].is(swift::tok::kw_as) &&
+           GetArrayElementType(tokens, after + 1, as_type))
+        {
+            type = as_type;
+            has_type = true;
+            after += 4;
+        }
+        bool is_whole_expression = after >= tokens.size() || tokens[after].isAtStartOfLine() ||
+                                   tokens[after].isAny(swift::tok::semi, swift::tok::r_brace, swift::tok::eof);
+        if(!is_whole_expression)
+            continue;
+        if(!has_type)
+        {
+            if(!is_untyped_binding && !is_statement)
+                continue;
+            // What the literal defaults to without context
+            GetElementType(has_float_literal ? "Double" : "Int", type);
+        }
+
+        size_t stride = type.bit_width / 8;
+        std::unique_ptr<uint64_t[]> blob(new uint64_t[(elements.size() * stride + 7) / 8]);
+        char *out = reinterpret_cast<char *>(blob.get());
+        bool encoded = true;
+        for(size_t element = 0; element < elements.size() && encoded; element++)
+            encoded = EncodeElement(elements[element], type, out + element * stride);
+        if(!encoded)
+            continue;
+
+        size_t begin_offset = src_mgr.getLocOffsetInBuffer(tokens[i].getLoc(), buffer_id);
+        size_t end_offset = src_mgr.getLocOffsetInBuffer(tokens[end].getLoc(), buffer_id) + 1;
+        stream << text.slice(copied_until, begin_offset);
+        size_t rewritten_begin = stream.tell();
+        // The newlines go first, so that whatever follows the literal stays on its line
+        stream << std::string(text.slice(begin_offset, end_offset).count('\n'), '\n')
+               << "Swift.Array(Swift.UnsafeBufferPointer(start: Swift.UnsafePointer<Swift." << type.name
+               << ">(bitPattern: " << reinterpret_cast<uintptr_t>(blob.get()) << "), count: "
+               << elements.size() << "))";
+        lowered_literals.push_back({ begin_offset, end_offset, rewritten_begin, static_cast<size_t>(stream.tell()) });
+        copied_until = end_offset;
+        blobs.push_back(std::move(blob));
+        lowered = true;
+        i = end;
+    }
+    if(!lowered)
+        return false;
+    stream << text.substr(copied_until);
+    stream.flush();
+    return true;
+}
+
+size_t GetOriginalOffset(const std::vector<LoweredLiteral> &lowered_literals, size_t offset)
+{
+    size_t original = offset;
+    for(const LoweredLiteral &literal : lowered_literals)
+    {
+        if(offset <= literal.rewritten_begin)
+            break;
+        if(offset < literal.rewritten_end)
+            return literal.end;
+        original = literal.end + (offset - literal.rewritten_end);
+    }
+    return original;
+}
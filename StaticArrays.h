@@ -0,0 +1,48 @@
+#ifndef STATIC_ARRAYS_H
+#define STATIC_ARRAYS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <swift/Basic/LangOptions.h>
+#include <swift/Basic/SourceManager.h>
+
+// At -Onone an array literal becomes one store per element in SIL and IR, so a pasted
+// table of a few thousand numbers takes seconds to compile. Large literals of integer
+// and floating point literals whose element type can be read off the source, like
+//     let table: [UInt16] = [1, 2, 3, ...]
+//     let table = [1.5, 2, -3, ...]            (Double, as the literal would default to)
+//     [1, 2, 3, ...] as [Float]
+// An untyped literal inside braces is left alone, since it may be a closure's or
+// function's implicit return and take its type from there.
+// are instead encoded into a blob in the REPL's memory, and the literal is replaced by
+// a copy of the blob into a new Array. The replacement keeps the literal's newlines so
+// that the rest of the buffer keeps its line numbers.
+//
+// Where a replaced literal was in the buffer and where its replacement is in the
+// rewritten text, as offsets
+struct LoweredLiteral
+{
+    size_t begin;
+    size_t end;
+    size_t rewritten_begin;
+    size_t rewritten_end;
+};
+
+// Returns true and sets rewritten to the new text of the buffer if any literal was
+// replaced, with the replaced literals in lowered_literals in order. The blobs are
+// appended to blobs and must outlive all code using them.
+bool LowerStaticArrayLiterals(const swift::SourceManager &src_mgr,
+                              const swift::LangOptions &lang_opts,
+                              unsigned buffer_id,
+                              std::string &rewritten,
+                              std::vector<LoweredLiteral> &lowered_literals,
+                              std::vector<std::unique_ptr<uint64_t[]>> &blobs);
+
+// Maps an offset in the rewritten text to the buffer it was rewritten from. Offsets
+// within a replacement map to the end of its literal.
+size_t GetOriginalOffset(const std::vector<LoweredLiteral> &lowered_literals, size_t offset);
+
+#endif
@@ -64,7 +64,83 @@ void CombineTopLevelDeclsAndMoveToBack(swift::SourceFile &src_file)
     src_file.Decls.push_back(new_tld);
 }
 
-void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file)
+// Builds a type-checked call to print(value), where value is already type-checked
+static swift::CallExpr *CreatePrintCall(swift::ASTContext &ast_ctx, swift::Expr *value)
+{
+    llvm::SmallVector<swift::ValueDecl *, 0> lookup_result;
+    ast_ctx.getStdlibModule()->lookupMember(
+        lookup_result,
+        ast_ctx.getStdlibModule(),
+        swift::DeclName(ast_ctx.getIdentifier("print")),
+        swift::Identifier());
+
+    swift::ValueDecl *print_decl = lookup_result.front();
+    lookup_result.clear();
+
+    swift::Type string_type;
+    for(auto *file : ast_ctx.getStdlibModule()->getFiles())
+        file->lookupValue({}, ast_ctx.getIdentifier("String"), swift::NLKind::UnqualifiedLookup, lookup_result);
+
+    if(auto *type_decl = llvm::dyn_cast<swift::NominalTypeDecl>(lookup_result.front()))
+        string_type = type_decl->getDeclaredType();
+    assert(string_type);
+
+    swift::Identifier separator_id = ast_ctx.getIdentifier("separator");
+    swift::Identifier terminator_id = ast_ctx.getIdentifier("terminator");
+
+    swift::Type print_type = swift::FunctionType::get(
+        {
+            swift::AnyFunctionType::Param(ast_ctx.TheAnyType, swift::Identifier(), swift::ParameterTypeFlags().withVariadic(true)),
+            swift::AnyFunctionType::Param(string_type, separator_id),
+            swift::AnyFunctionType::Param(string_type, terminator_id),
+        },
+        ast_ctx.TheEmptyTupleType);
+
+    swift::DeclRefExpr *print_ref = new (ast_ctx) swift::DeclRefExpr(
+        swift::ConcreteDeclRef(print_decl),
+        swift::DeclNameLoc(), true, swift::AccessSemantics::Ordinary, print_type);
+
+    swift::ErasureExpr *erasure = swift::ErasureExpr::create(
+        ast_ctx, value, ast_ctx.TheAnyType, {});
+
+    swift::ArrayExpr *array = swift::ArrayExpr::create(
+        ast_ctx, swift::SourceLoc(), { erasure }, {}, swift::SourceLoc(), swift::ArraySliceType::get(ast_ctx.TheAnyType));
+
+    swift::VarargExpansionExpr *vararg = new (ast_ctx) swift::VarargExpansionExpr(
+        array, false, array->getType());
+
+    swift::DefaultArgumentExpr *default_separator = new (ast_ctx) swift::DefaultArgumentExpr(
+        swift::ConcreteDeclRef(print_decl), 1, swift::SourceLoc(), string_type);
+
+    swift::DefaultArgumentExpr *default_terminator = new (ast_ctx) swift::DefaultArgumentExpr(
+        swift::ConcreteDeclRef(print_decl), 2, swift::SourceLoc(), string_type);
+
+    swift::Type tuple_type = swift::TupleType::get(
+        {
+            swift::TupleTypeElt(array->getType(), swift::Identifier(), swift::ParameterTypeFlags().withVariadic(true)),
+            swift::TupleTypeElt(string_type, separator_id),
+            swift::TupleTypeElt(string_type, terminator_id),
+        },
+        ast_ctx);
+
+    swift::TupleExpr *tuple = swift::TupleExpr::create(
+        ast_ctx, swift::SourceLoc(),
+        { vararg, default_separator, default_terminator },
+        { swift::Identifier(), separator_id, terminator_id },
+        { swift::SourceLoc(), swift::SourceLoc(), swift::SourceLoc() },
+        swift::SourceLoc(), false, true,
+        tuple_type);
+
+    swift::CallExpr *call = swift::CallExpr::create(
+        ast_ctx, print_ref, tuple,
+        { swift::Identifier() },
+        { swift::SourceLoc(), swift::SourceLoc(), swift::SourceLoc() },
+        false, true, ast_ctx.TheEmptyTupleType);
+    call->setThrows(false);
+    return call;
+}
+
+void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file, bool print_result)
 {
     if(src_file.Decls.empty())
         return;
@@ -110,82 +186,13 @@ void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file)
                 last_expr, last_top_level_code_decl);
 
         *back_iterator = assignment;
-
-        // Insert print statement:
-        llvm::SmallVector<swift::ValueDecl *, 0> lookup_result;
-        ast_ctx.getStdlibModule()->lookupMember(
-            lookup_result,
-            ast_ctx.getStdlibModule(),
-            swift::DeclName(ast_ctx.getIdentifier("print")),
-            swift::Identifier());
-
-        swift::ValueDecl *print_decl = lookup_result.front();
-        lookup_result.clear();
-
-        swift::Type string_type;
-        for(auto *file : ast_ctx.getStdlibModule()->getFiles())
-            file->lookupValue({}, ast_ctx.getIdentifier("String"), swift::NLKind::UnqualifiedLookup, lookup_result);
-
-        if(auto *type_decl = llvm::dyn_cast<swift::NominalTypeDecl>(lookup_result.front()))
-            string_type = type_decl->getDeclaredType();
-        assert(string_type);
-
-        swift::Identifier separator_id = ast_ctx.getIdentifier("separator");
-        swift::Identifier terminator_id = ast_ctx.getIdentifier("terminator");
-
-        swift::Type print_type = swift::FunctionType::get(
-            {
-                swift::AnyFunctionType::Param(ast_ctx.TheAnyType, swift::Identifier(), swift::ParameterTypeFlags().withVariadic(true)),
-                swift::AnyFunctionType::Param(string_type, separator_id),
-                swift::AnyFunctionType::Param(string_type, terminator_id),
-            },
-            ast_ctx.TheEmptyTupleType);
-
-        swift::DeclRefExpr *print_ref = new (ast_ctx) swift::DeclRefExpr(
-            swift::ConcreteDeclRef(print_decl),
-            swift::DeclNameLoc(), true, swift::AccessSemantics::Ordinary, print_type);
+        if(!print_result)
+            return;
 
         swift::DeclRefExpr *res_var_ref = new (ast_ctx) swift::DeclRefExpr(
             swift::ConcreteDeclRef(return_var),
             swift::DeclNameLoc(), true, swift::AccessSemantics::Ordinary, return_type);
-
-        swift::ErasureExpr *erasure = swift::ErasureExpr::create(
-            ast_ctx, res_var_ref, ast_ctx.TheAnyType, {});
-
-        swift::ArrayExpr *array = swift::ArrayExpr::create(
-            ast_ctx, swift::SourceLoc(), { erasure }, {}, swift::SourceLoc(), swift::ArraySliceType::get(ast_ctx.TheAnyType));
-
-        swift::VarargExpansionExpr *vararg = new (ast_ctx) swift::VarargExpansionExpr(
-            array, false, array->getType());
-
-        swift::DefaultArgumentExpr *default_separator = new (ast_ctx) swift::DefaultArgumentExpr(
-            swift::ConcreteDeclRef(print_decl), 1, swift::SourceLoc(), string_type);
-
-        swift::DefaultArgumentExpr *default_terminator = new (ast_ctx) swift::DefaultArgumentExpr(
-            swift::ConcreteDeclRef(print_decl), 2, swift::SourceLoc(), string_type);
-
-        swift::Type tuple_type = swift::TupleType::get(
-            {
-                swift::TupleTypeElt(array->getType(), swift::Identifier(), swift::ParameterTypeFlags().withVariadic(true)),
-                swift::TupleTypeElt(string_type, separator_id),
-                swift::TupleTypeElt(string_type, terminator_id),
-            },
-            ast_ctx);
-
-        swift::TupleExpr *tuple = swift::TupleExpr::create(
-            ast_ctx, swift::SourceLoc(),
-            { vararg, default_separator, default_terminator },
-            { swift::Identifier(), separator_id, terminator_id },
-            { swift::SourceLoc(), swift::SourceLoc(), swift::SourceLoc() },
-            swift::SourceLoc(), false, true,
-            tuple_type);
-
-        swift::CallExpr *call = swift::CallExpr::create(
-            ast_ctx, print_ref, tuple,
-            { swift::Identifier() },
-            { swift::SourceLoc(), swift::SourceLoc(), swift::SourceLoc() },
-            false, true, ast_ctx.TheEmptyTupleType);
-        call->setThrows(false);
+        swift::CallExpr *call = CreatePrintCall(ast_ctx, res_var_ref);
 
         // Append the call to print to the body
         std::vector<swift::ASTNode> new_body;
@@ -201,6 +208,36 @@ void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file)
     }
 }
 
+// Used for scripts, where the whole file is one input: every top-level expression
+// gets its result printed, as it would if it had been entered on its own line.
+void PrintTopLevelExpressionResults(swift::SourceFile &src_file)
+{
+    swift::ASTContext &ast_ctx = src_file.getASTContext();
+    for(swift::Decl *decl : src_file.Decls)
+    {
+        auto *top_level_code_decl = llvm::dyn_cast<swift::TopLevelCodeDecl>(decl);
+        if(!top_level_code_decl)
+            continue;
+
+        for(swift::ASTNode &element : top_level_code_decl->getBody()->getElements())
+        {
+            swift::Expr *expr = element.dyn_cast<swift::Expr *>();
+            if(!expr || !expr->getType() || expr->getType()->hasError())
+                continue;
+
+            swift::Type type = expr->getType();
+            if(type->is<swift::LValueType>())
+            {
+                type = type->getRValueType();
+                expr = new (ast_ctx) swift::LoadExpr(expr, type);
+            }
+            if(swift::CanType(type) == swift::CanType(ast_ctx.TheEmptyTupleType))
+                continue;
+            element = CreatePrintCall(ast_ctx, expr);
+        }
+    }
+}
+
 void WrapInFunction(swift::SourceFile &src_file)
 {
     if(src_file.Decls.empty())
@@ -8,7 +8,9 @@
 void AddImportNodes(swift::SourceFile &src_file,
                     const std::vector<swift::ImportDecl *> &import_decls);
 void CombineTopLevelDeclsAndMoveToBack(swift::SourceFile &src_file);
-void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file);
+// The result is only printed if print_result is true; it is always assigned to the global
+void TransformFinalExpressionAndAddGlobal(swift::SourceFile &src_file, bool print_result = true);
+void PrintTopLevelExpressionResults(swift::SourceFile &src_file);
 void WrapInFunction(swift::SourceFile &src_file);
 void MakeDeclarationsPublic(swift::SourceFile &src_file);
 
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "swift_repl.h"
+
+// Evaluates each line of stdin through the C API and reports what came back on stderr,
+// since stdout is redirected while there is an output sink. With --no-print, results
+// are only read with swift_repl_get_result. Used by the tests.
+
+static const char *g_status_names[] = { "ok", "error", "exited" };
+static const char *g_kind_names[] = { "error", "warning", "remark", "note" };
+
+static void OnOutput(void *context, const char *data, size_t size)
+{
+    size_t *total = (size_t *)context;
+    *total += size;
+    fprintf(stderr, "output: %.*s", (int)size, data);
+}
+
+static void OnDiagnostic(void *context, swift_repl_diagnostic_kind kind,
+                         unsigned line, unsigned column, const char *message, size_t size)
+{
+    (void)context;
+    fprintf(stderr, "diagnostic: %s %u:%u %.*s\n", g_kind_names[kind], line, column, (int)size, message);
+}
+
+static void PrintResult(const swift_repl_result *result)
+{
+    size_t i;
+    switch(result->kind)
+    {
+    case SWIFT_REPL_RESULT_INT:
+        fprintf(stderr, "Int%u %lld", result->bit_width, (long long)result->int_value);
+        break;
+    case SWIFT_REPL_RESULT_UINT:
+        fprintf(stderr, "UInt%u %llu", result->bit_width, (unsigned long long)result->uint_value);
+        break;
+    case SWIFT_REPL_RESULT_FLOAT:
+    case SWIFT_REPL_RESULT_DOUBLE:
+        fprintf(stderr, "Float%u %g", result->bit_width, result->float_value);
+        break;
+    case SWIFT_REPL_RESULT_BOOL:
+        fprintf(stderr, "Bool %s", result->bool_value ? "true" : "false");
+        break;
+    case SWIFT_REPL_RESULT_STRING:
+        fprintf(stderr, "String \"%.*s\"", (int)result->count, (const char *)result->data);
+        break;
+    case SWIFT_REPL_RESULT_ARRAY:
+        fprintf(stderr, "Array of %zu [", result->count);
+        for(i = 0; i < result->count; i++)
+        {
+            swift_repl_result element;
+            swift_repl_get_element(result, i, &element);
+            fprintf(stderr, i == 0 ? "" : ", ");
+            PrintResult(&element);
+        }
+        fprintf(stderr, "]");
+        break;
+    case SWIFT_REPL_RESULT_UNSUPPORTED:
+        fprintf(stderr, "unsupported");
+        break;
+    case SWIFT_REPL_RESULT_NONE:
+        fprintf(stderr, "none");
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t output_size = 0;
+    char line[4096];
+    swift_repl_session *session = swift_repl_create(NULL);
+    if(!session)
+    {
+        fprintf(stderr, "Failed to create a session\n");
+        return 1;
+    }
+    if(!swift_repl_set_output_sink(session, OnOutput, &output_size))
+    {
+        fprintf(stderr, "Failed to capture stdout\n");
+        swift_repl_destroy(session);
+        return 1;
+    }
+    swift_repl_set_diagnostic_sink(session, OnDiagnostic, NULL);
+    if(argc > 1 && strcmp(argv[1], "--no-print") == 0)
+        swift_repl_set_print_results(session, 0);
+
+    while(fgets(line, sizeof(line), stdin))
+    {
+        swift_repl_status status = swift_repl_eval(session, line, strcspn(line, "\r\n"));
+        fprintf(stderr, "status: %s\n", g_status_names[status]);
+        if(status == SWIFT_REPL_OK)
+        {
+            swift_repl_result result;
+            swift_repl_get_result(session, &result);
+            if(result.kind != SWIFT_REPL_RESULT_NONE)
+            {
+                fprintf(stderr, "result: ");
+                PrintResult(&result);
+                fprintf(stderr, "\n");
+            }
+        }
+        if(status == SWIFT_REPL_EXITED)
+            break;
+    }
+    fprintf(stderr, "total output: %zu bytes\n", output_size);
+    swift_repl_destroy(session);
+    return 0;
+}
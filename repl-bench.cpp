@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#include "Logging.h"
+#include "REPL.h"
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+// repl-bench drives the REPL directly with synthetic sessions and reports how
+// per-input latency grows with session length. Everything the REPL prints is
+// sent to the null device; the report goes to stderr and optionally to a JSON file.
+//
+// Usage: repl-bench [--workloads=literals,funcs,...] [--lengths=10,100,...]
+//                   [--json=out.json] [--optimize=true]
+
+struct Workload
+{
+    const char *name;
+    std::string (*make_input)(int i);
+};
+
+static const Workload g_workloads[] =
+{
+    { "literals",      [](int i) { return std::to_string(i); } },
+    { "funcs",         [](int i) { return "func f" + std::to_string(i) + "() -> Int { return " + std::to_string(i) + " }"; } },
+    { "classes",       [](int i) { return "class C" + std::to_string(i) + " { var x = " + std::to_string(i) + " }"; } },
+    { "redefinitions", [](int i) { return "func g() -> Int { return " + std::to_string(i) + " }"; } },
+    { "imports",       [](int i) { return std::string("import Swift"); } },
+};
+
+struct BenchOptions
+{
+    std::vector<std::string> workloads;
+    std::vector<int> lengths = { 10, 100, 1000, 10000 };
+    std::string json_path;
+    bool optimize = false;
+};
+
+struct BenchResult
+{
+    std::string workload;
+    int length;
+    // Inputs with errors, which are left out of the latencies
+    int failures;
+    double total_ms;
+    double mean_us;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double max_us;
+    // Median latency of the last 10% of inputs divided by the first 10%.
+    // A pipeline whose per-input cost is independent of session length stays near 1.
+    double growth;
+};
+
+static BenchOptions ParseBenchOptions(int argc, char **argv)
+{
+    BenchOptions opts;
+    for(int i = 1; i < argc; i++)
+    {
+        llvm::StringRef opt, val;
+        std::tie(opt, val) = llvm::StringRef(argv[i]).split('=');
+        llvm::SmallVector<llvm::StringRef, 8> items;
+        val.split(items, ',', -1, false);
+        if(opt == "--workloads")
+        {
+            for(llvm::StringRef item : items)
+                opts.workloads.push_back(item.str());
+        }
+        else if(opt == "--lengths")
+        {
+            opts.lengths.clear();
+            for(llvm::StringRef item : items)
+            {
+                int length;
+                if(!item.getAsInteger(10, length) && length > 0)
+                    opts.lengths.push_back(length);
+            }
+        }
+        else if(opt == "--json")
+        {
+            opts.json_path = val.str();
+        }
+        else if(opt == "--optimize")
+        {
+            opts.optimize = val == "true";
+        }
+        else
+        {
+            std::cerr << "[Warning] Ignoring unrecognized parameter \"" << argv[i] << "\"\n";
+        }
+    }
+    if(opts.workloads.empty())
+    {
+        for(const Workload &workload : g_workloads)
+            opts.workloads.push_back(workload.name);
+    }
+    return opts;
+}
+
+static double Percentile(const std::vector<double> &sorted, double p)
+{
+    if(sorted.empty())
+        return 0.0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return Percentile(values, 0.5);
+}
+
+static bool RunWorkload(const Workload &workload, int length, bool optimize, BenchResult &result)
+{
+    llvm::Expected<std::unique_ptr<REPL>> repl = REPL::Create();
+    if(!repl)
+    {
+        llvm::consumeError(repl.takeError());
+        return false;
+    }
+    (*repl)->SetOptimizationsEnabled(optimize);
+
+    // stdout goes to the null device, so errors are shown on stderr instead
+    std::string errors;
+    (*repl)->SetDiagnosticHandler([&](const REPL::Diagnostic &diagnostic)
+                                  {
+                                      if(diagnostic.kind == swift::DiagnosticKind::Error)
+                                          errors += "    " + diagnostic.message + "\n";
+                                  });
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(length);
+    result.failures = 0;
+    for(int i = 0; i < length; i++)
+    {
+        std::string input = workload.make_input(i);
+        errors.clear();
+        auto start = std::chrono::steady_clock::now();
+        bool executed = (*repl)->ExecuteSwift(input) && !(*repl)->LastInputHadError();
+        auto end = std::chrono::steady_clock::now();
+        // Failed inputs stop early, so they aren't timed
+        if(!executed)
+        {
+            if(result.failures++ == 0)
+                std::cerr << "[Warning] " << workload.name << " input " << i << " failed:\n" << input << "\n" << errors;
+            continue;
+        }
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    std::cout.flush();
+    fflush(stdout);
+    if(latencies_us.empty())
+        latencies_us.push_back(0.0);
+
+    size_t tenth = std::max<size_t>(1, latencies_us.size() / 10);
+    double first = Median(std::vector<double>(latencies_us.begin(), latencies_us.begin() + tenth));
+    double last = Median(std::vector<double>(latencies_us.end() - tenth, latencies_us.end()));
+
+    double total_us = std::accumulate(latencies_us.begin(), latencies_us.end(), 0.0);
+    std::sort(latencies_us.begin(), latencies_us.end());
+    result.workload = workload.name;
+    result.length = length;
+    result.total_ms = total_us / 1000.0;
+    result.mean_us = total_us / latencies_us.size();
+    result.p50_us = Percentile(latencies_us, 0.50);
+    result.p90_us = Percentile(latencies_us, 0.90);
+    result.p99_us = Percentile(latencies_us, 0.99);
+    result.max_us = latencies_us.back();
+    result.growth = first > 0.0 ? last / first : 0.0;
+    return true;
+}
+
+static void WriteJSON(const std::vector<BenchResult> &results, std::ostream &out)
+{
+    out << "{\n  \"results\": [\n";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        out << "    { \"workload\": \"" << r.workload << "\", \"length\": " << r.length
+            << ", \"failures\": " << r.failures
+            << ", \"total_ms\": " << r.total_ms
+            << ", \"mean_us\": " << r.mean_us
+            << ", \"p50_us\": " << r.p50_us
+            << ", \"p90_us\": " << r.p90_us
+            << ", \"p99_us\": " << r.p99_us
+            << ", \"max_us\": " << r.max_us
+            << ", \"growth\": " << r.growth << " }"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opts = ParseBenchOptions(argc, argv);
+    LoggingOptions logging_opts;
+    logging_opts.log_areas = LoggingArea::All;
+    logging_opts.min_priority = LoggingPriority::None;
+    SetLoggingOptions(logging_opts);
+
+    // Silence everything the REPL and the JIT'd code print
+    fflush(stdout);
+    if(!freopen(NULL_DEVICE, "w", stdout))
+    {
+        std::cerr << "[Error] Failed to redirect stdout\n";
+        return 1;
+    }
+
+    std::vector<BenchResult> results;
+    for(const std::string &name : opts.workloads)
+    {
+        auto workload = std::find_if(std::begin(g_workloads), std::end(g_workloads),
+                                     [&](const Workload &w) { return name == w.name; });
+        if(workload == std::end(g_workloads))
+        {
+            std::cerr << "[Warning] Unknown workload \"" << name << "\"\n";
+            continue;
+        }
+
+        for(int length : opts.lengths)
+        {
+            BenchResult result;
+            if(!RunWorkload(*workload, length, opts.optimize, result))
+            {
+                std::cerr << "[Error] Failed to create REPL\n";
+                return 1;
+            }
+            std::cerr << result.workload << " x" << result.length
+                      << ": total " << result.total_ms << " ms"
+                      << ", p50 " << result.p50_us << " us"
+                      << ", p90 " << result.p90_us << " us"
+                      << ", p99 " << result.p99_us << " us"
+                      << ", max " << result.max_us << " us"
+                      << ", growth " << result.growth << "x"
+                      << (result.failures ? ", " + std::to_string(result.failures) + " failed inputs (not timed)" : std::string())
+                      << "\n";
+            results.push_back(result);
+        }
+    }
+
+    if(!opts.json_path.empty())
+    {
+        std::ofstream json(opts.json_path);
+        if(!json)
+        {
+            std::cerr << "[Error] Failed to open " << opts.json_path << "\n";
+            return 1;
+        }
+        WriteJSON(results, json);
+    }
+    return 0;
+}
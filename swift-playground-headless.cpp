@@ -0,0 +1,215 @@
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+
+#include "CommandLineOptions.h"
+#include "PlaygroundEngine.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+// A line oriented driver for the playground engine, so that the playground can be run
+// and benchmarked without a UI. Requests are read from stdin:
+//
+//     text <N>\n<N bytes>   Replace the document
+//     edit <offset> <removed> <N>\n<N bytes>
+//                           Replace <removed> bytes at <offset> with the N bytes
+//     run                   Recompile and execute everything
+//     continue              Execute the lines after the last executed line
+//     check                 Wait for the background type-check of the current text
+//                           and report its diagnostics
+//     log                   Report the values and execution counts logged so far
+//                           (with --playground_logging=true)
+//     status                Report the current state
+//     quit
+//
+// Responses are written to stdout:
+//
+//     output <N>\n<N bytes> Output of the executed code, possibly in several pieces
+//     ok <request> <line execution continues from> <number of lines>
+//     diagnostic <line>:<column> <kind> <message>
+//     ok check <number of diagnostics>
+//     log <line>:<column> value|scope <execution count> <last described value>
+//     ok log <number of entries>
+//     error <message>
+//
+// All output of a run or continue request is written before its ok response.
+
+static std::mutex g_stdout_lock;
+static int g_stdout_fd = -1;
+
+static std::mutex g_diagnostics_lock;
+static std::vector<REPL::Diagnostic> g_diagnostics;
+
+static void WriteAll(const char *data, size_t size)
+{
+    while(size > 0)
+    {
+        int written = write(g_stdout_fd, data, static_cast<unsigned>(size));
+        if(written <= 0)
+            return;
+        data += written;
+        size -= written;
+    }
+}
+
+static void WriteResponse(const std::string &header, const char *data = nullptr, size_t size = 0)
+{
+    std::lock_guard<std::mutex> guard(g_stdout_lock);
+    std::string line = header + "\n";
+    WriteAll(line.data(), line.size());
+    if(data)
+        WriteAll(data, size);
+}
+
+static bool ReadPayload(size_t size, std::string &payload)
+{
+    payload.resize(size);
+    return size == 0 || std::cin.read(&payload[0], size);
+}
+
+static const char *DiagnosticKindString(swift::DiagnosticKind kind)
+{
+    switch(kind)
+    {
+    case swift::DiagnosticKind::Error:
+        return "error";
+    case swift::DiagnosticKind::Warning:
+        return "warning";
+    case swift::DiagnosticKind::Remark:
+        return "remark";
+    case swift::DiagnosticKind::Note:
+        return "note";
+    }
+    return "";
+}
+
+static void WriteStatus(const std::string &request, const PlaygroundEngine &engine)
+{
+    WriteResponse("ok " + request + " " + std::to_string(engine.GetMinLine()) + " " +
+                  std::to_string(engine.GetRawLineCount()));
+}
+
+int main(int argc, char **argv)
+{
+    CommandLineOptions opts = ParseCommandLineOptions(argc, argv);
+    SetLoggingOptions(opts.logging_opts);
+
+    PlaygroundEngine engine(opts);
+    PlaygroundEngine::Callbacks callbacks;
+    callbacks.on_output = [](const char *data, size_t size)
+    {
+        WriteResponse("output " + std::to_string(size), data, size);
+    };
+    callbacks.on_diagnostics = [](const std::vector<REPL::Diagnostic> &diagnostics)
+    {
+        std::lock_guard<std::mutex> guard(g_diagnostics_lock);
+        g_diagnostics = diagnostics;
+    };
+    if(!engine.Start(callbacks))
+        return 1;
+    g_stdout_fd = engine.GetOriginalStdout();
+
+    std::string request;
+    while(std::getline(std::cin, request))
+    {
+        if(!request.empty() && request.back() == '\r')
+            request.pop_back();
+
+        if(request.compare(0, 5, "text ") == 0)
+        {
+            size_t size;
+            std::string text;
+            if(llvm::StringRef(request).substr(5).getAsInteger(10, size))
+            {
+                WriteResponse("error malformed text request");
+                break;
+            }
+            if(!ReadPayload(size, text))
+            {
+                WriteResponse("error truncated text request");
+                break;
+            }
+            engine.SetText(text);
+            WriteStatus("text", engine);
+        }
+        else if(request.compare(0, 5, "edit ") == 0)
+        {
+            llvm::SmallVector<llvm::StringRef, 3> fields;
+            llvm::StringRef(request).substr(5).split(fields, ' ', -1, false);
+            size_t offset, removed, size;
+            std::string inserted;
+            if(fields.size() != 3 ||
+               fields[0].getAsInteger(10, offset) ||
+               fields[1].getAsInteger(10, removed) ||
+               fields[2].getAsInteger(10, size))
+            {
+                WriteResponse("error malformed edit request");
+                break;
+            }
+            if(!ReadPayload(size, inserted))
+            {
+                WriteResponse("error truncated edit request");
+                break;
+            }
+            engine.ApplyEdit(offset, removed, inserted);
+            WriteStatus("edit", engine);
+        }
+        else if(request == "run")
+        {
+            engine.RecompileEverything();
+            engine.FlushOutput();
+            WriteStatus(request, engine);
+        }
+        else if(request == "continue")
+        {
+            engine.ContinueExecution();
+            engine.FlushOutput();
+            WriteStatus(request, engine);
+        }
+        else if(request == "check")
+        {
+            engine.WaitForCheck();
+            std::lock_guard<std::mutex> guard(g_diagnostics_lock);
+            for(const REPL::Diagnostic &diagnostic : g_diagnostics)
+            {
+                WriteResponse("diagnostic " + std::to_string(diagnostic.line) + ":" + std::to_string(diagnostic.column) + " " +
+                              DiagnosticKindString(diagnostic.kind) + " " + diagnostic.message);
+            }
+            WriteResponse("ok check " + std::to_string(g_diagnostics.size()));
+        }
+        else if(request == "log")
+        {
+            std::vector<PlaygroundLogEntry> entries = engine.GetLogEntries();
+            for(const PlaygroundLogEntry &entry : entries)
+            {
+                WriteResponse("log " + std::to_string(entry.start_line) + ":" + std::to_string(entry.start_column) + " " +
+                              (entry.kind == PlaygroundLogKind::Value ? "value " : "scope ") +
+                              std::to_string(entry.count) + " " + entry.value);
+            }
+            WriteResponse("ok log " + std::to_string(entries.size()));
+        }
+        else if(request == "status")
+        {
+            WriteStatus(request, engine);
+        }
+        else if(request == "quit")
+        {
+            break;
+        }
+        else if(!request.empty())
+        {
+            WriteResponse("error unknown request " + request);
+        }
+    }
+    engine.FlushOutput();
+    return 0;
+}
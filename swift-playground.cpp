@@ -1,31 +1,32 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <mutex>
+#include <vector>
 
 #include "CommandLineOptions.h"
-#include "REPL.h"
-#include "Strings.h"
+#include "PlaygroundEngine.h"
 
 #include <windows.h>
 #include <windowsx.h>
 #include <winuser.h>
 #include <richedit.h>
-#include <namedpipeapi.h>
-#include <io.h>
-#include <fcntl.h>
 
 #define BACKGROUND_COLOR RGB(0x1E, 0x1E, 0x1E)
 #define FOREGROUND_COLOR RGB(0xDC, 0xDC, 0xDC)
 #define BUTTON_WIDTH 150
 #define BUTTON_HEIGHT 50
+#define WM_DIAGNOSTICS_READY (WM_APP + 1)
+#define WM_OUTPUT_READY (WM_APP + 2)
 
 CommandLineOptions g_opts;
 
-HANDLE g_stdout_write_pipe;
-HANDLE g_stdout_read_pipe;
 HWND g_output;
-std::vector<char> g_output_text;
+std::string g_pending_output;
 std::mutex g_output_text_lock;
+HWND g_window;
+std::mutex g_diagnostics_lock;
+std::vector<REPL::Diagnostic> g_diagnostics;
 
 void SetFontToConsolas(HWND window_handle)
 {
@@ -94,54 +95,88 @@ std::string GetTextboxText(HWND textbox)
     return std::string(buff.data());
 }
 
-unsigned long UpdateOutputTextbox(void *)
+// Output arrives as coalesced appends on the capture's delivery thread. Sending them
+// to the control from there would deadlock with the UI thread while it waits in
+// FlushOutput, so they are queued and the UI thread is told with a posted message.
+void UpdateOutputTextbox(const char *buff, size_t bytes_read)
 {
-    for(;;)
+    bool was_empty;
     {
-        char buff[128];
-        DWORD bytes_read;
-        ReadFile(g_stdout_read_pipe, buff, sizeof(buff), &bytes_read, nullptr);
+        std::lock_guard<std::mutex> guard(g_output_text_lock);
+        was_empty = g_pending_output.empty();
+        g_pending_output.append(buff, bytes_read);
+    }
+    if(was_empty)
+        PostMessage(g_window, WM_OUTPUT_READY, 0, 0);
+}
 
-        {
-            std::lock_guard<std::mutex> guard(g_output_text_lock);
-            g_output_text.insert(g_output_text.end(),
-                                 buff, buff + bytes_read);
-            g_output_text.push_back('\0');
-            Edit_SetText(g_output, g_output_text.data());
-            g_output_text.pop_back();
-        }
+// We only ever insert the new text at the end instead of resetting the whole control
+void AppendPendingOutput()
+{
+    std::string output;
+    {
+        std::lock_guard<std::mutex> guard(g_output_text_lock);
+        output.swap(g_pending_output);
     }
+    if(output.empty())
+        return;
+    CHARRANGE end_of_text = { -1, -1 };
+    SendMessage(g_output, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&end_of_text));
+    SendMessage(g_output, EM_REPLACESEL, false, reinterpret_cast<LPARAM>(output.c_str()));
 }
 
 void ClearOutputTextBox()
 {
     std::lock_guard<std::mutex> guard(g_output_text_lock);
-    g_output_text.clear();
+    g_pending_output.clear();
     char null_char = '\0';
     Edit_SetText(g_output, &null_char);
 }
 
+// Diagnostics arrive on the background checking thread, so they are handed to the
+// UI thread with a posted message
+void PublishDiagnostics(const std::vector<REPL::Diagnostic> &diagnostics)
+{
+    {
+        std::lock_guard<std::mutex> guard(g_diagnostics_lock);
+        g_diagnostics = diagnostics;
+    }
+    PostMessage(g_window, WM_DIAGNOSTICS_READY, 0, 0);
+}
+
+void ShowDiagnostics(HWND window)
+{
+    std::lock_guard<std::mutex> guard(g_diagnostics_lock);
+    auto first_error = std::find_if(g_diagnostics.begin(), g_diagnostics.end(),
+                                    [](const REPL::Diagnostic &d) { return d.kind == swift::DiagnosticKind::Error; });
+    std::string title = "Swift Playground";
+    if(first_error != g_diagnostics.end())
+        title += " - Line " + std::to_string(first_error->line) + ": " + first_error->message;
+    SetWindowText(window, title.c_str());
+}
+
 struct Playground
 {
     void LayoutWindow();
-    void ResetREPL();
     void UpdateContinueButtonText();
+    void SnapshotSelection();
     void HandleTextChange();
     void RecompileEverything();
     void ContinueExecution();
     void UpdateLineNumbers(int num_lines);
+    void UpdateLineNumbersWidth(int num_lines);
 
     HWND m_window;
     HWND m_recompile_btn;
     HWND m_continue_btn;
     HWND m_text;
     HWND m_line_numbers;
-    int m_min_line;
-    int m_num_lines;
     int m_line_numbers_width;
-    std::string m_prev_text;
-    std::string m_curr_text;
-    std::unique_ptr<REPL> m_repl;
+    int m_line_numbers_count;
+    // Selection and length of m_text before the message that changed it
+    CHARRANGE m_prev_selection;
+    LONG m_prev_length;
+    std::unique_ptr<PlaygroundEngine> m_engine;
 };
 
 void Playground::LayoutWindow()
@@ -192,89 +227,104 @@ void Playground::LayoutWindow()
     RedrawWindow(g_output, nullptr, nullptr, RDW_INVALIDATE);
 }
 
-void Playground::ResetREPL()
-{
-    llvm::Expected<std::unique_ptr<REPL>> repl = REPL::Create(g_opts.is_playground);
-    if(!repl)
-    {
-        std::string err_str;
-        llvm::raw_string_ostream stream(err_str);
-        stream << repl.takeError();
-        stream.flush();
-        SetCurrentLoggingArea(LoggingArea::All);
-        Log(err_str, LoggingPriority::Error);
-    }
-
-    std::for_each(g_opts.include_paths.begin(), g_opts.include_paths.end(),
-                  [&](auto s) { (*repl)->AddModuleSearchPath(s); });
-    std::for_each(g_opts.link_paths.begin(), g_opts.link_paths.end(),
-                  [&](auto s) { (*repl)->AddLoadSearchPath(s); });
-
-    m_repl = std::move(*repl);
-}
-
 void Playground::UpdateContinueButtonText()
 {
-    std::string new_btn_text = "Continue Execution from Line " + std::to_string(m_min_line);
-    if(m_min_line == 0)
+    int min_line = m_engine->GetMinLine();
+    std::string new_btn_text = "Continue Execution from Line " + std::to_string(min_line);
+    if(min_line == 0)
         new_btn_text = "Recompile Everything";
     Button_SetText(m_continue_btn, new_btn_text.c_str());
 }
 
+// The gutter only ever changes at the end, so lines are appended or removed there
+// rather than regenerating all of it.
 void Playground::UpdateLineNumbers(int num_lines)
 {
     //TODO(sasha): Handle word wrapping
-    std::string line_numbers_text = "";
-    for(int i = 1; i <= num_lines; i++)
-        line_numbers_text += std::to_string(i) + ".\n";
-    Edit_SetText(m_line_numbers, line_numbers_text.c_str());
+    if(num_lines > m_line_numbers_count)
+    {
+        std::string new_lines = "";
+        for(int i = m_line_numbers_count + 1; i <= num_lines; i++)
+            new_lines += std::to_string(i) + ".\n";
+        CHARRANGE end_of_text = { -1, -1 };
+        SendMessage(m_line_numbers, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&end_of_text));
+        SendMessage(m_line_numbers, EM_REPLACESEL, false, reinterpret_cast<LPARAM>(new_lines.c_str()));
+    }
+    else if(num_lines < m_line_numbers_count)
+    {
+        LONG first_removed = static_cast<LONG>(SendMessage(m_line_numbers, EM_LINEINDEX, num_lines, 0));
+        CHARRANGE removed = { first_removed, -1 };
+        SendMessage(m_line_numbers, EM_EXSETSEL, 0, reinterpret_cast<LPARAM>(&removed));
+        SendMessage(m_line_numbers, EM_REPLACESEL, false, reinterpret_cast<LPARAM>(""));
+    }
+    m_line_numbers_count = num_lines;
     SendMessage(m_line_numbers, EM_SHOWSCROLLBAR, SB_VERT, false);
 }
 
+void Playground::UpdateLineNumbersWidth(int num_lines)
+{
+    int width = max(static_cast<int>(log10(num_lines) + 1.0f) * 15, 45);
+    if(width == m_line_numbers_width)
+        return;
+    m_line_numbers_width = width;
+    LayoutWindow();
+}
+
+void Playground::SnapshotSelection()
+{
+    SendMessage(m_text, EM_EXGETSEL, 0, reinterpret_cast<LPARAM>(&m_prev_selection));
+    GETTEXTLENGTHEX length_info = { GTL_NUMCHARS | GTL_PRECISE, CP_ACP };
+    m_prev_length = static_cast<LONG>(SendMessage(m_text, EM_GETTEXTLENGTHEX, reinterpret_cast<WPARAM>(&length_info), 0));
+}
+
+// An edit replaces a single range and leaves the caret after the inserted text, so
+// comparing the selection and length from before the change with the ones after it
+// tells us what was removed and inserted without looking at the rest of the text.
+// If that doesn't add up (e.g. the text was changed without going through the message
+// loop), fall back to handing the engine the whole text.
 void Playground::HandleTextChange()
 {
-    m_curr_text = GetTextboxText(m_text);
+    CHARRANGE selection;
+    SendMessage(m_text, EM_EXGETSEL, 0, reinterpret_cast<LPARAM>(&selection));
+    GETTEXTLENGTHEX length_info = { GTL_NUMCHARS | GTL_PRECISE, CP_ACP };
+    LONG length = static_cast<LONG>(SendMessage(m_text, EM_GETTEXTLENGTHEX, reinterpret_cast<WPARAM>(&length_info), 0));
+
+    LONG caret = selection.cpMax;
+    LONG start = min(m_prev_selection.cpMin, caret);
+    LONG removed = (m_prev_length - start) - (length - caret);
+    if(start >= 0 && removed >= 0 && start + removed <= m_prev_length)
+    {
+        std::vector<char> inserted(caret - start + 1);
+        TEXTRANGE range = { { start, caret }, inserted.data() };
+        SendMessage(m_text, EM_GETTEXTRANGE, 0, reinterpret_cast<LPARAM>(&range));
+        // Rich edit controls end paragraphs with a single '\r'; keep offsets the same
+        std::string text(inserted.data(), caret - start);
+        std::replace(text.begin(), text.end(), '\r', '\n');
+        m_engine->ApplyEdit(start, removed, text);
+    }
+    else
+    {
+        std::string text = GetTextboxText(m_text);
+        std::replace(text.begin(), text.end(), '\r', '\n');
+        m_engine->SetText(text);
+    }
+    SnapshotSelection();
 
-    int num_lines_raw = std::count(m_curr_text.begin(), m_curr_text.end(), '\n') + 1;
-    m_line_numbers_width = max(static_cast<int>(log10(num_lines_raw) + 1.0f) * 15, 45);
-    LayoutWindow();
+    int num_lines_raw = m_engine->GetRawLineCount();
+    UpdateLineNumbersWidth(num_lines_raw);
     UpdateLineNumbers(num_lines_raw);
-
-    Trim(m_curr_text);
-    m_curr_text.erase(std::remove(m_curr_text.begin(), m_curr_text.end(), '\r'), m_curr_text.end()); // Effectively changes \r\n to \n
-    if(!StartsWith(m_curr_text, m_prev_text))
-        m_min_line = 0;
-    m_num_lines = std::count(m_curr_text.begin(), m_curr_text.end(), '\n') + 1;
     UpdateContinueButtonText();
 }
 
 void Playground::RecompileEverything()
 {
-    ResetREPL();
-    ClearOutputTextBox();
-    m_repl->ExecuteSwift(m_curr_text);
-    m_prev_text = m_curr_text;
-    m_min_line = m_num_lines;
+    m_engine->RecompileEverything();
     UpdateContinueButtonText();
 }
 
 void Playground::ContinueExecution()
 {
-    if(m_min_line == 0)
-        return RecompileEverything();
-
-    int i = 0;
-    for(int curr_line = 1; i < m_curr_text.size(); i++)
-    {
-        if(m_curr_text[i] == '\n')
-            curr_line++;
-        if(curr_line == m_min_line + 1)
-            break;
-    }
-    std::string to_execute = m_curr_text.substr(i);
-    m_repl->ExecuteSwift(to_execute);
-    m_prev_text = m_curr_text;
-    m_min_line = m_num_lines;
+    m_engine->ContinueExecution();
     UpdateContinueButtonText();
 }
 
@@ -306,6 +356,16 @@ LRESULT CALLBACK PlaygroundWindowProc(HWND window_handle, UINT message, WPARAM w
         }
         return 0;
     }
+    case WM_DIAGNOSTICS_READY:
+    {
+        ShowDiagnostics(window_handle);
+        return 0;
+    }
+    case WM_OUTPUT_READY:
+    {
+        AppendPendingOutput();
+        return 0;
+    }
     case WM_DESTROY:
     {
         PostQuitMessage(0);
@@ -353,6 +413,7 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    g_window = window;
     Playground playground = {};
     SetWindowLongPtr(window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(&playground));
 
@@ -363,9 +424,9 @@ int main(int argc, char **argv)
     playground.m_continue_btn = CreateButton(instance_handle, window,
                                              CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
                                              "Continue Execution From Line 1");
-    playground.m_min_line = 0;
-    playground.m_num_lines = 1;
+    playground.m_engine = std::make_unique<PlaygroundEngine>(g_opts);
     playground.m_line_numbers_width = 45;
+    playground.m_line_numbers_count = 0;
     playground.m_text = CreateRichEdit(
         instance_handle, window,
         CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT);
@@ -379,38 +440,29 @@ int main(int argc, char **argv)
         CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT);
 
     Edit_SetReadOnly(g_output, true);
+    // Rich edit controls stop accepting text at 32K characters by default
+    SendMessage(g_output, EM_EXLIMITTEXT, 0, 0x7FFFFFFE);
 
     playground.LayoutWindow();
 
     ShowWindow(window, SW_SHOW);
 
-    //NOTE(sasha): There are \Bigg{\emph{\textbf{SEVERE}}} performance issues if
-    //             pipe buffer size is too small. We just pass the standard on Linux,
-    //             which is 0xFFFF.
-    if(!CreatePipe(&g_stdout_read_pipe, &g_stdout_write_pipe, nullptr, 0xFFFF))
-    {
-        Log(std::string("Failed to create pipe. Last Error: ") + std::to_string(GetLastError()), LoggingPriority::Error);
-        return 1;
-    }
-    if(!SetStdHandle(STD_OUTPUT_HANDLE, g_stdout_write_pipe))
-    {
-        Log(std::string("Failed to set std handle. Last Error: ") + std::to_string(GetLastError()), LoggingPriority::Error);
+    PlaygroundEngine::Callbacks callbacks;
+    callbacks.on_output = UpdateOutputTextbox;
+    callbacks.on_clear_output = ClearOutputTextBox;
+    callbacks.on_diagnostics = PublishDiagnostics;
+    if(!playground.m_engine->Start(callbacks))
         return 1;
-    }
-    int fd = _open_osfhandle(reinterpret_cast<intptr_t>(g_stdout_write_pipe),
-                             _O_APPEND | _O_TEXT);
-    _dup2(fd, _fileno(stdout));
-
-    HANDLE update_thread = CreateThread(
-        nullptr, 0, UpdateOutputTextbox,
-        nullptr, 0, nullptr);
 
     MSG msg = {};
+    playground.SnapshotSelection();
+    playground.UpdateLineNumbers(1);
     while(GetMessage(&msg, nullptr, 0, 0))
     {
+        if(msg.hwnd == playground.m_text)
+            playground.SnapshotSelection();
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
-    _close(fd);
     return 0;
 }
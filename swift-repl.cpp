@@ -1,12 +1,33 @@
+#include <chrono>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "CommandLineOptions.h"
+#include "FramedProtocol.h"
+#include "OutputCapture.h"
 #include "REPL.h"
+#include "SessionLog.h"
 
-std::unique_ptr<REPL> SetupREPLWithOptions(int argc, char **argv)
+#ifdef _WIN32
+#include <cstdio>
+#include <fcntl.h>
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t MicrosecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+std::unique_ptr<REPL> SetupREPLWithOptions(const CommandLineOptions &opts)
 {
-    CommandLineOptions opts = ParseCommandLineOptions(argc, argv);
     SetLoggingOptions(opts.logging_opts);
 
     llvm::Expected<std::unique_ptr<REPL>> repl = REPL::Create(
@@ -22,6 +43,7 @@ std::unique_ptr<REPL> SetupREPLWithOptions(int argc, char **argv)
         return nullptr;
     }
 
+    (*repl)->SetOptimizationsEnabled(opts.optimize);
     std::for_each(opts.include_paths.begin(), opts.include_paths.end(),
                   [&](auto s) { (*repl)->AddModuleSearchPath(s); });
     std::for_each(opts.link_paths.begin(), opts.link_paths.end(),
@@ -29,16 +51,185 @@ std::unique_ptr<REPL> SetupREPLWithOptions(int argc, char **argv)
     return std::move(*repl);
 }
 
+// Re-executes a recorded session without prompts. With --timing, reports each input's
+// latency against the recorded one on stderr so that it doesn't mix with the output.
+int ReplaySession(REPL &repl, const CommandLineOptions &opts)
+{
+    std::vector<SessionLogEntry> entries;
+    if(!ReadSessionLog(opts.replay_path, entries))
+        return 1;
+
+    uint64_t total_recorded_us = 0;
+    uint64_t total_replayed_us = 0;
+    int outcome_mismatches = 0;
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        const SessionLogEntry &entry = entries[i];
+        Clock::time_point start = Clock::now();
+        bool keep_going = repl.ExecuteSwift(entry.input);
+        uint64_t replayed_us = MicrosecondsBetween(start, Clock::now());
+        bool succeeded = !repl.LastInputHadError();
+
+        total_recorded_us += entry.duration_us;
+        total_replayed_us += replayed_us;
+        if(succeeded != entry.succeeded)
+            outcome_mismatches++;
+
+        if(opts.timing)
+        {
+            std::cout.flush();
+            double delta = entry.duration_us ?
+                100.0 * (static_cast<double>(replayed_us) - entry.duration_us) / entry.duration_us : 0.0;
+            std::cerr << "[" << i + 1 << "] recorded " << entry.duration_us << " us, replayed "
+                      << replayed_us << " us (" << (delta >= 0.0 ? "+" : "") << delta << "%)"
+                      << (succeeded != entry.succeeded ? " OUTCOME MISMATCH" : "") << "\n";
+        }
+        if(!keep_going)
+            break;
+    }
+
+    if(opts.timing)
+    {
+        std::cerr << "Total: recorded " << total_recorded_us << " us, replayed "
+                  << total_replayed_us << " us over " << entries.size() << " inputs";
+        if(outcome_mismatches)
+            std::cerr << ", " << outcome_mismatches << " outcome mismatches";
+        std::cerr << "\n";
+    }
+    return outcome_mismatches ? 1 : 0;
+}
+
+// Type-checks every line of stdin on its own without running anything or keeping
+// declarations, for validating snippets. Diagnostics go to stdout; the exit code is
+// 1 if any line had errors.
+int CheckInputs(REPL &repl)
+{
+    int failures = 0;
+    std::string line;
+    while(std::getline(std::cin, line))
+    {
+        if(line.empty())
+            continue;
+        if(repl.IsExitString(line))
+            break;
+        if(!repl.CheckSwift(line))
+            failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+static bool WriteAll(int fd, const std::string &data)
+{
+    const char *remaining = data.data();
+    size_t size = data.size();
+    while(size > 0)
+    {
+        auto written = write(fd, remaining, static_cast<unsigned>(size));
+        if(written <= 0)
+            return false;
+        remaining += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Serves --protocol=framed, described in FramedProtocol.h. Everything the REPL and the
+// code it runs write to stdout is captured and sent back in the response to the input
+// that wrote it; the frames go to the original stdout.
+int ServeFramedProtocol(REPL &repl)
+{
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    std::mutex output_lock;
+    std::string output;
+    OutputCapture capture;
+    bool started = capture.Start([&](const char *data, size_t size)
+                                 {
+                                     std::lock_guard<std::mutex> guard(output_lock);
+                                     output.append(data, size);
+                                 });
+    if(!started)
+        return 1;
+    int frame_fd = capture.GetOriginalStdout();
+#ifdef _WIN32
+    _setmode(frame_fd, _O_BINARY);
+#endif
+
+    FramedResponse response;
+    repl.SetDiagnosticHandler([&](const REPL::Diagnostic &diagnostic)
+                              {
+                                  response.diagnostics.push_back(diagnostic);
+                              });
+
+    std::string request;
+    bool keep_going = true;
+    while(keep_going && ReadFrame(std::cin, request))
+    {
+        response.diagnostics.clear();
+        Clock::time_point start = Clock::now();
+        keep_going = repl.ExecuteSwift(request);
+        response.duration_us = MicrosecondsBetween(start, Clock::now());
+        capture.Flush();
+        {
+            std::lock_guard<std::mutex> guard(output_lock);
+            response.output.swap(output);
+            output.clear();
+        }
+
+        if(!keep_going)
+            response.status = FramedStatus::Exited;
+        else if(repl.LastInputHadError())
+            response.status = FramedStatus::Error;
+        else
+            response.status = FramedStatus::Ok;
+        if(!WriteAll(frame_fd, EncodeResponse(response)))
+            break;
+    }
+    capture.Stop();
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
-    std::unique_ptr<REPL> repl = SetupREPLWithOptions(argc, argv);
+    CommandLineOptions opts = ParseCommandLineOptions(argc, argv);
+    std::unique_ptr<REPL> repl = SetupREPLWithOptions(opts);
     if(!repl)
         return 1;
 
-    std::string line;
+    if(!opts.replay_path.empty())
+        return ReplaySession(*repl, opts);
+    if(!opts.script_path.empty())
+        return repl->ExecuteScript(opts.script_path) ? 0 : 1;
+    if(opts.check_only)
+        return CheckInputs(*repl);
+    if(opts.framed_protocol)
+        return ServeFramedProtocol(*repl);
+
+    SessionRecorder recorder;
+    bool is_recording = !opts.record_path.empty();
+    if(is_recording && !recorder.Open(opts.record_path))
+    {
+        SetCurrentLoggingArea(LoggingArea::All);
+        Log("Failed to open " + opts.record_path + " for recording", LoggingPriority::Error);
+        return 1;
+    }
+
+    // Recording keeps inputs to one line each, so that each has its own latency and outcome
+    Clock::time_point session_start = Clock::now();
+    bool keep_going;
     do
     {
-        line = repl->GetLine();
-    } while(repl->ExecuteSwift(line));
+        std::vector<std::string> lines = repl->GetLines(!is_recording);
+        Clock::time_point start = Clock::now();
+        keep_going = repl->ExecuteSwiftLines(lines);
+        if(is_recording)
+        {
+            recorder.Record({ MicrosecondsBetween(session_start, start),
+                              MicrosecondsBetween(start, Clock::now()),
+                              !repl->LastInputHadError(),
+                              lines.front() });
+        }
+    } while(keep_going);
     return 0;
 }
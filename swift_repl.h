@@ -0,0 +1,129 @@
+#ifndef SWIFT_REPL_C_API_H
+#define SWIFT_REPL_C_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A C interface to the REPL, for evaluating Swift in-process from other programs.
+//
+// A session is a REPL: declarations made by one evaluation are visible to the next.
+// Sessions are independent of each other, but evaluations are serialized across all
+// of them because they share the process's stdout.
+//
+// Everything evaluated code prints goes to the process's stdout, as do the REPL's
+// diagnostics unless a diagnostic sink is set. Once any session has an output sink,
+// stdout is redirected into a pipe for as long as one does. Output written during an
+// evaluation is handed to that session's sink before swift_repl_eval returns; output
+// written at any other time goes to the original stdout.
+
+#ifdef _WIN32
+#ifdef SWIFT_REPL_BUILDING_LIBRARY
+#define SWIFT_REPL_API __declspec(dllexport)
+#else
+#define SWIFT_REPL_API __declspec(dllimport)
+#endif
+#else
+#define SWIFT_REPL_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct swift_repl_session swift_repl_session;
+
+typedef enum
+{
+    SWIFT_REPL_OK = 0,
+    // The input had errors and was not executed
+    SWIFT_REPL_ERROR = 1,
+    // The input was an exit command. The session can still be used.
+    SWIFT_REPL_EXITED = 2,
+} swift_repl_status;
+
+typedef enum
+{
+    SWIFT_REPL_DIAGNOSTIC_ERROR = 0,
+    SWIFT_REPL_DIAGNOSTIC_WARNING = 1,
+    SWIFT_REPL_DIAGNOSTIC_REMARK = 2,
+    SWIFT_REPL_DIAGNOSTIC_NOTE = 3,
+} swift_repl_diagnostic_kind;
+
+// data points into the session's capture buffer and is only valid for the duration
+// of the call. It is not null-terminated. Called on an internal thread.
+typedef void (*swift_repl_output_fn)(void *context, const char *data, size_t size);
+
+// message is only valid for the duration of the call. line and column are 1-based,
+// or 0 if the diagnostic has no location. Called on the thread calling swift_repl_eval.
+typedef void (*swift_repl_diagnostic_fn)(void *context, swift_repl_diagnostic_kind kind,
+                                         unsigned line, unsigned column,
+                                         const char *message, size_t size);
+
+typedef enum
+{
+    // The input had no result or wasn't executed
+    SWIFT_REPL_RESULT_NONE = 0,
+    SWIFT_REPL_RESULT_INT = 1,
+    SWIFT_REPL_RESULT_UINT = 2,
+    SWIFT_REPL_RESULT_FLOAT = 3,
+    SWIFT_REPL_RESULT_DOUBLE = 4,
+    SWIFT_REPL_RESULT_BOOL = 5,
+    SWIFT_REPL_RESULT_STRING = 6,
+    SWIFT_REPL_RESULT_ARRAY = 7,
+    SWIFT_REPL_RESULT_UNSUPPORTED = 8,
+} swift_repl_result_kind;
+
+// The value of an input's result, read from Swift's memory without formatting it
+typedef struct
+{
+    swift_repl_result_kind kind;
+    // Of INT, UINT (8 to 64), FLOAT (32) and DOUBLE (64)
+    unsigned bit_width;
+    int64_t int_value;
+    uint64_t uint_value;
+    // FLOAT values are widened
+    double float_value;
+    int bool_value;
+    // A STRING's UTF-8 code units (not null-terminated) or an ARRAY's elements,
+    // element_stride bytes apart. They point into Swift's storage and stay valid until
+    // the session is destroyed.
+    const void *data;
+    size_t count;
+    swift_repl_result_kind element_kind;
+    unsigned element_bit_width;
+    size_t element_stride;
+} swift_repl_result;
+
+// module_cache_path may be NULL to use the default. Returns NULL on failure.
+SWIFT_REPL_API swift_repl_session *swift_repl_create(const char *module_cache_path);
+SWIFT_REPL_API void swift_repl_destroy(swift_repl_session *session);
+
+SWIFT_REPL_API void swift_repl_set_optimizations_enabled(swift_repl_session *session, int enabled);
+SWIFT_REPL_API void swift_repl_add_module_search_path(swift_repl_session *session, const char *path);
+SWIFT_REPL_API void swift_repl_add_library_search_path(swift_repl_session *session, const char *path);
+
+// Pass NULL to go back to writing to stdout. Returns 0 if stdout could not be redirected.
+SWIFT_REPL_API int swift_repl_set_output_sink(swift_repl_session *session,
+                                              swift_repl_output_fn fn, void *context);
+// Pass NULL to go back to printing diagnostics
+SWIFT_REPL_API void swift_repl_set_diagnostic_sink(swift_repl_session *session,
+                                                   swift_repl_diagnostic_fn fn, void *context);
+
+// source is one input, as it would be typed at the prompt. It needs no terminator.
+SWIFT_REPL_API swift_repl_status swift_repl_eval(swift_repl_session *session,
+                                                 const char *source, size_t length);
+
+// Whether results are printed like at the prompt. They can be read with
+// swift_repl_get_result either way.
+SWIFT_REPL_API void swift_repl_set_print_results(swift_repl_session *session, int print);
+// The result of the last evaluation
+SWIFT_REPL_API void swift_repl_get_result(swift_repl_session *session, swift_repl_result *result);
+// An element of an ARRAY result. Elements that are Strings are read like a STRING result.
+SWIFT_REPL_API void swift_repl_get_element(const swift_repl_result *array, size_t index,
+                                           swift_repl_result *element);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
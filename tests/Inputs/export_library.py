@@ -0,0 +1,11 @@
+# Prints a session that exports its declarations as a shared library, some of them on
+# the same line as array literals that are lowered to static data
+import sys
+
+literal = '[' + ', '.join(str(i) for i in range(300)) + ']'
+print('let a = ' + literal + '; let b = 1')
+print('let t: [Int] = ' + literal + '; t.count')
+print('struct Point { var x: Double; var y: Double; func norm() -> Double { return (x * x + y * y).squareRoot() } }')
+print('func mean(_ values: [Double]) -> Double { return values.reduce(0, +) / Double(values.count) }')
+print(':export ' + sys.argv[1])
+print('e')
@@ -0,0 +1,6 @@
+#include <stdint.h>
+
+__attribute__((swiftcall)) int64_t link_mul(int64_t a, int64_t b)
+{
+    return a * b;
+}
@@ -0,0 +1,5 @@
+func square(_ x: Int) -> Int { return x * x }
+func norm2(_ p: Point) -> Int { return square(p.x) + square(p.y) }
+struct Point { var x: Int; var y: Int }
+let origin = Point(x: 0, y: 0)
+norm2(Point(x: 3, y: 4))
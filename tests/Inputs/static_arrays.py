@@ -0,0 +1,21 @@
+# Prints REPL input with array literals large enough to be lowered to static data
+def literal(values):
+    return '[' + ', '.join(values) + ']'
+
+print('let t: [UInt16] = ' + literal(str(i) for i in range(1000)))
+print('t.count')
+print('t == (0..<1000).map { UInt16($0) }')
+print('let d = ' + literal(repr(i / 10) for i in range(300)))
+print('d[1] == 0.1 && d[299] == 29.9')
+print('let s = ' + literal(str(i) for i in range(-150, 150)) + ' as [Int16]')
+print('s.reduce(0, +)')
+# The REPL reads a line at a time, so the function has to be on one line
+print('func table() -> [Float] { let x: [Float] = ' + literal('0x%x' % i for i in range(300)) + '; return x }')
+print('table()[255] + table()[1]')
+# Implicit returns take the element type from the context, so these stay literals
+print('func bytes() -> [UInt8] { ' + literal(str(i) for i in range(256)) + ' }')
+print('bytes()[255]')
+print('let f: () -> [UInt8] = { ' + literal(str(i) for i in range(256)) + ' }')
+print('f()[254]')
+print('let bad: [UInt8] = ' + literal(str(i) for i in range(300)))
+print('e')
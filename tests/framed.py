@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Encodes and decodes the frames of swift-repl --protocol=framed (see FramedProtocol.h).
+#
+#   framed.py encode INPUT...
+#       Writes a request frame for each input to stdout.
+#   framed.py decode
+#       Reads response frames from stdin and prints them as text.
+
+import struct
+import sys
+
+STATUSES = ['ok', 'error', 'exited']
+KINDS = ['error', 'warning', 'remark', 'note']
+
+
+def encode(inputs):
+    out = sys.stdout.buffer
+    for text in inputs:
+        data = text.encode('utf-8')
+        out.write(struct.pack('<I', len(data)) + data)
+
+
+def decode():
+    data = sys.stdin.buffer.read()
+    offset = 0
+
+    def take(fmt):
+        nonlocal offset
+        values = struct.unpack_from(fmt, data, offset)
+        offset += struct.calcsize(fmt)
+        return values[0]
+
+    def take_bytes():
+        nonlocal offset
+        size = take('<I')
+        value = data[offset:offset + size].decode('utf-8')
+        offset += size
+        return value
+
+    while offset < len(data):
+        size = take('<I')
+        end = offset + size
+        status = STATUSES[take('<B')]
+        take('<Q')  # duration
+        output = take_bytes()
+        print('response %s output=%r' % (status, output))
+        for _ in range(take('<I')):
+            kind = KINDS[take('<B')]
+            line = take('<I')
+            column = take('<I')
+            print('diagnostic %s %d:%d %s' % (kind, line, column, take_bytes()))
+        if offset != end:
+            sys.exit('frame size mismatch')
+
+
+def main():
+    if len(sys.argv) >= 2 and sys.argv[1] == 'encode':
+        encode(sys.argv[2:])
+    elif len(sys.argv) == 2 and sys.argv[1] == 'decode':
+        decode()
+    else:
+        sys.exit('usage: framed.py encode INPUT... | framed.py decode')
+
+
+if __name__ == '__main__':
+    main()
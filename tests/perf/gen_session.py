@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Generates large REPL sessions for the performance tests.
+#
+#   gen_session.py functions N [--redefine-every K]
+#       N function definitions. Every K-th input redefines an earlier function
+#       and calls it, so the output can be checked.
+#   gen_session.py literals N
+#       N integer literals.
+#   gen_session.py classes N
+#       N class definitions, each followed by an instantiation every 100 classes.
+
+import argparse
+import sys
+
+
+def functions(n, redefine_every):
+    for i in range(n):
+        print('func f%d() -> Int { return %d }' % (i, i))
+        if redefine_every and i > 0 and i % redefine_every == 0:
+            target = i // 2
+            print('func f%d() -> Int { return %d }' % (target, -target))
+            print('f%d()' % target)
+
+
+def literals(n):
+    for i in range(n):
+        print(i)
+
+
+def classes(n):
+    for i in range(n):
+        print('class C%d { var x = %d }' % (i, i))
+        if i % 100 == 0:
+            print('C%d().x' % i)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('kind', choices=['functions', 'literals', 'classes'])
+    parser.add_argument('count', type=int)
+    parser.add_argument('--redefine-every', type=int, default=0)
+    args = parser.parse_args()
+
+    if args.kind == 'functions':
+        functions(args.count, args.redefine_every)
+    elif args.kind == 'literals':
+        literals(args.count)
+    else:
+        classes(args.count)
+    print('e')
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+# Runs a command and fails if it exceeds a wall time or peak RSS budget.
+#
+#   run_with_budget.py [--scale=S] [--max-seconds=T] [--max-rss-mb=M] -- command args...
+#
+# stdin and stdout are passed through to the command, so it can be used in a pipeline.
+# Budgets are multiplied by --scale. Measurements are reported on stderr.
+
+import argparse
+import resource
+import subprocess
+import sys
+import time
+
+
+def main():
+    argv = sys.argv[1:]
+    if '--' not in argv:
+        print('usage: run_with_budget.py [options] -- command args...', file=sys.stderr)
+        return 2
+    split = argv.index('--')
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--scale', type=float, default=1.0)
+    parser.add_argument('--max-seconds', type=float, default=None)
+    parser.add_argument('--max-rss-mb', type=float, default=None)
+    args = parser.parse_args(argv[:split])
+    command = argv[split + 1:]
+
+    start = time.monotonic()
+    result = subprocess.run(command)
+    elapsed = time.monotonic() - start
+    # On Linux ru_maxrss is in kilobytes
+    peak_rss_mb = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss / 1024.0
+
+    print('[budget] %s: %.2f s, peak RSS %.1f MB' % (command[0], elapsed, peak_rss_mb), file=sys.stderr)
+    if result.returncode != 0:
+        print('[budget] command exited with %d' % result.returncode, file=sys.stderr)
+        return result.returncode
+
+    failed = False
+    if args.max_seconds is not None and elapsed > args.max_seconds * args.scale:
+        print('[budget] exceeded time budget of %.2f s' % (args.max_seconds * args.scale), file=sys.stderr)
+        failed = True
+    if args.max_rss_mb is not None and peak_rss_mb > args.max_rss_mb * args.scale:
+        print('[budget] exceeded memory budget of %.1f MB' % (args.max_rss_mb * args.scale), file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())